@@ -93,6 +93,7 @@ class IChannelConversion {
   void Parameter(size_t index, double parameter);
 
   void ChannelDataType(uint8_t channel_data_type);
+  [[nodiscard]] uint8_t ChannelDataType() const; ///< The channels data type.
 
   template<typename T, typename V>
   bool Convert(const T& channel_value, V& eng_value) const {
@@ -50,6 +50,7 @@ class IChannelGroup {
   void ResetSample() const;
   void IncrementSample() const;
   [[nodiscard]] size_t Sample() const;
+  void Sample(size_t sample) const; ///< Sets the sample index of the next record.
  protected:
   mutable std::vector<uint8_t> sample_buffer_; ///< Temporary record when saving samples.
  private:
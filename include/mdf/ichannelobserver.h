@@ -35,6 +35,15 @@ class IChannelObserver : public ISampleObserver
 
   [[nodiscard]] virtual size_t NofSamples() const = 0;
 
+  /** \brief Returns the file sample index of the observer's sample 0.
+   *
+   * This is 0 unless a sample range was read. The observer then holds the
+   * samples of the range only.
+   */
+  [[nodiscard]] virtual size_t FirstSample() const {
+    return 0;
+  }
+
   [[nodiscard]] std::string Name() const;
 
   [[nodiscard]] std::string Unit() const;
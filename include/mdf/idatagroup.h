@@ -34,6 +34,10 @@ class IDataGroup {
   void DetachSampleObserver(const ISampleObserver* observer) const;
   void DetachAllSampleObservers() const;
   void NotifySampleObservers(size_t sample, uint64_t record_id, const std::vector<uint8_t>& record) const;
+  /** \brief Returns true if any attached observer needs the records with a record ID. */
+  [[nodiscard]] bool IsRecordIdNeeded(uint64_t record_id) const;
+  /** \brief Tells the attached observers which samples the next read notifies. */
+  void NotifySampleRange(size_t first_sample, size_t nof_samples) const;
 
   void ResetSample() const;
   void SetAsRead(bool mark_as_read = true) const {
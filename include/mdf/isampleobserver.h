@@ -12,6 +12,30 @@ class ISampleObserver {
   ISampleObserver() = default;
   virtual ~ISampleObserver() = default;
   virtual void OnSample(size_t sample, uint64_t record_id, const std::vector<uint8_t>& record) = 0;
+
+  /** \brief Returns true if the observer needs the records with a record ID.
+   *
+   * Records that no observer needs are skipped when reading, without being
+   * copied or notified. The default is to need all records.
+   * @param record_id Record ID of a channel group.
+   * @return True if OnSample shall be called for the records.
+   */
+  [[nodiscard]] virtual bool IsRecordIdNeeded(uint64_t /*record_id*/) const {
+    return true;
+  }
+
+  /** \brief Called before the samples of a read are notified.
+   *
+   * A ranged read only notifies the samples from the first sample and at most
+   * the number of samples. The sample indexes in OnSample are unchanged. An
+   * observer that stores the samples only needs room for the range. A full
+   * read has the first sample 0 and an unlimited number of samples. The
+   * default does nothing.
+   * @param first_sample Index of the first notified sample.
+   * @param nof_samples Max number of notified samples per channel group.
+   */
+  virtual void OnSampleRange(size_t /*first_sample*/, size_t /*nof_samples*/) {
+  }
 };
 
 }
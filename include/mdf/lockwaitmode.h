@@ -0,0 +1,27 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstdint>
+
+namespace mdf {
+
+/** \brief Defines how to wait for a file that is locked by a writer.
+ *
+ * The file may temporary be locked by a writer. The sleep mode sleeps 10 ms
+ * between the open attempts. The yield mode first yields the thread between
+ * the attempts, so the file is opened as soon as it is released. After a
+ * thousand attempts it backs off to short sleeps, so it doesn't spin a core
+ * for the whole timeout. The no-wait mode fails directly.
+ *
+ * Only lock type errors are retried. Other open errors, for example a
+ * directory instead of a file, fail directly.
+ */
+enum class LockWaitMode : uint8_t {
+  Sleep = 0, ///< Sleep between open attempts (default).
+  Yield = 1, ///< Yield the thread between open attempts.
+  NoWait = 2 ///< Fail directly if the file is locked.
+};
+
+}  // namespace mdf
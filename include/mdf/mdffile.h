@@ -139,7 +139,7 @@ class MdfFile {
    * read in any other information as measurement information.
    * @param file Pointer to an opened file.
    */
-  virtual void ReadHeader(std::FILE *file) = 0;
+  virtual void ReadHeader(std::streambuf& file) = 0;
 
   /** \brief Reads the measurement information about the file.
    *
@@ -150,7 +150,7 @@ class MdfFile {
    *
    * @param file Pointer to an opened file.
    */
-  virtual void ReadMeasurementInfo(std::FILE *file) = 0;
+  virtual void ReadMeasurementInfo(std::streambuf& file) = 0;
 
   /** \brief Reads in all expect raw data from the file.
    *
@@ -159,7 +159,7 @@ class MdfFile {
    * There is no need to call the ReadHeader or ReadMeasurement functions before this function.
    *
    * @param file Pointer to an opened file.
-   */   virtual void ReadEverythingButData(std::FILE *file) = 0;
+   */   virtual void ReadEverythingButData(std::streambuf& file) = 0;
 
    /** \brief Saves all blocks onto the file.
     *
@@ -7,10 +7,89 @@
 #include <cstdio>
 #include <string>
 #include <memory>
+#include <streambuf>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <span>
+#include "mdf/lockwaitmode.h"
 #include "mdf/mdffile.h"
 
 namespace mdf {
 
+namespace detail {
+class BlockArena;
+}
+
+/** \brief Defines how the reader access the file.
+ *
+ * The default backend use a normal buffered file stream. The memory mapped
+ * backend maps the whole file into the address space, which makes the block
+ * reads a plain memory copy. This is typically much faster when reading
+ * the block structure of large files.
+ *
+ * The positional backend reads by file offset (pread) and doesn't have a
+ * shared file position. The memory mapped and positional backends allow
+ * concurrent ReadData() calls on different data groups, see
+ * MdfReader::ReadData().
+ *
+ * The memory backend reads from a caller-owned buffer. It is selected by
+ * the MdfReader constructor that takes a memory buffer and also allow
+ * concurrent ReadData() calls.
+ */
+enum class ReadBackend : uint8_t {
+  FileStream = 0, ///< Buffered file stream (default).
+  MemoryMapped = 1, ///< Memory mapped file.
+  Positional = 2, ///< Offset-addressed reads (pread).
+  Memory = 3 ///< Caller-owned memory buffer.
+};
+
+/** \brief Defines how long the reader keeps the file open.
+ *
+ * The default is to keep the file open for the reader's lifetime. The open
+ * per call policy releases the file handle between the calls, which is
+ * useful when many readers exist at the same time. The shared cache policy
+ * shares one file handle between all readers of the same file. This is
+ * supported by the memory mapped and positional backends. The file stream
+ * backend keeps the file open instead.
+ */
+enum class FileHandlePolicy : uint8_t {
+  KeepOpen = 0, ///< Keep the file open (default).
+  OpenPerCall = 1, ///< Opens and closes the file in each read call.
+  SharedCache = 2 ///< Share file handles between readers of the same file.
+};
+
+/** \brief File access options for the reader.
+ *
+ * With lazy channels, ReadEverythingButData() doesn't read the channel blocks
+ * of an MDF4 file. A channel group reads its channels the first time they are
+ * accessed, and a channel reads its conversion, source, unit and comment
+ * blocks the first time any of them is accessed. This speeds up the opening
+ * of files with many channels when only a few of them are used.
+ *
+ * With the block arena, the block objects are allocated from a few large
+ * memory buffers that the reader owns. Building and releasing the block
+ * tree of a large file is then much faster.
+ *
+ * With parse threads, ReadEverythingButData() reads the channel blocks of
+ * different MDF4 data groups in parallel. Each thread reads through its own
+ * file handle or file position.
+ *
+ * With inflate threads, ReadData() inflates the compressed (DZ) data blocks of
+ * an MDF4 data group in parallel. The blocks ahead of the parsed block are
+ * inflated by worker threads, while the records still are parsed in order.
+ */
+struct MdfReaderOptions {
+  ReadBackend backend = ReadBackend::FileStream; ///< Type of file access.
+  FileHandlePolicy handle_policy = FileHandlePolicy::KeepOpen; ///< File handle lifetime.
+  LockWaitMode lock_wait = LockWaitMode::Sleep; ///< Wait strategy for locked files.
+  std::chrono::milliseconds lock_timeout = std::chrono::seconds(60); ///< Max wait for a locked file.
+  bool lazy_channels = false; ///< Read the MDF4 channel blocks on demand.
+  bool block_arena = false; ///< Allocate the blocks from a memory arena.
+  size_t parse_threads = 0; ///< Max threads when reading the blocks. Less than 2 means no threads.
+  size_t inflate_threads = 0; ///< Max threads when inflating data blocks. Less than 2 means no threads.
+};
+
 using ChannelObserverPtr = std::unique_ptr<IChannelObserver>;
 using ChannelObserverList = std::vector<ChannelObserverPtr>;
 
@@ -41,7 +120,30 @@ void CreateChannelObserverForChannelGroup(const IDataGroup& data_group,
  */
  class MdfReader {
  public:
-  explicit MdfReader(const std::string &filename); ///< Constructor that opens the file and read ID and HD block.
+  /** \brief Constructor that opens the file and read ID and HD block.
+   *
+   * @param filename Full path to the file.
+   * @param backend Type of file access to use.
+   */
+  explicit MdfReader(const std::string &filename,
+                     ReadBackend backend = ReadBackend::FileStream);
+  /** \brief Constructor that opens the file and read ID and HD block.
+   *
+   * @param filename Full path to the file.
+   * @param options File access options.
+   */
+  MdfReader(const std::string &filename, const MdfReaderOptions& options);
+
+  /** \brief Constructor that reads the ID and HD block from a memory buffer.
+   *
+   * The whole MDF file is in a caller-owned buffer. All blocks and data are
+   * read directly from the buffer, so the buffer must be valid for the
+   * reader's lifetime. The backend option is ignored and set to memory.
+   * @param buffer The MDF file in memory.
+   * @param options Reader options.
+   */
+  explicit MdfReader(std::span<const uint8_t> buffer,
+                     const MdfReaderOptions& options = {});
   virtual~MdfReader(); ///< Destructor that close any open file and destructs.
 
   MdfReader() = delete;
@@ -84,6 +186,15 @@ void CreateChannelObserverForChannelGroup(const IDataGroup& data_group,
 
   [[nodiscard]] std::string ShortName() const; ///< Returns the file name without paths.
 
+  [[nodiscard]] ReadBackend Backend() const { ///< Returns the type of file access.
+    return options_.backend;
+  }
+
+  /// Returns the file access options.
+  [[nodiscard]] const MdfReaderOptions& Options() const {
+    return options_;
+  }
+
   bool Open(); ///< Opens the file stream for reading.
   void Close();///< Closes the file stream.
 
@@ -99,13 +210,98 @@ void CreateChannelObserverForChannelGroup(const IDataGroup& data_group,
    */
   bool ExportAttachmentData(const IAttachment& attachment, const std::string& dest_file);
 
-  bool ReadData(const IDataGroup& data_group); ///< Reads the sample data. See sample observer.
+  /** \brief Reads the sample data. See sample observer.
+   *
+   * With the memory mapped or positional backend and an open file, each call
+   * reads through its own file position. Different data groups may then be
+   * read at the same time from different threads. Note that the file must be
+   * opened, see Open(), and the block information read before the threads
+   * starts.
+   * @param data_group Data group to read.
+   * @return True on success.
+   */
+  bool ReadData(const IDataGroup& data_group);
+
+  /** \brief Reads a range of samples. See sample observer.
+   *
+   * Only the samples from the first sample, and at most the number of samples
+   * per channel group, are notified. The channel observers then hold the
+   * samples of the range only, where observer sample 0 is the first sample,
+   * see IChannelObserver::FirstSample().
+   *
+   * A sorted data group (one channel group) with fixed length records is
+   * read from the first sample. The data blocks before the range are not
+   * read. Other data groups are parsed from the start, up to the range end.
+   * @param data_group Data group to read.
+   * @param first_sample Index of the first sample.
+   * @param nof_samples Max number of samples.
+   * @return True on success.
+   */
+  bool ReadData(const IDataGroup& data_group, size_t first_sample, size_t nof_samples);
+
+  /** \brief Reads the samples within a time range. See sample observer.
+   *
+   * The samples with a master value from the start time up to and including
+   * the end time are read as a sample range, see ReadData(). The range is
+   * found by a binary search on the master channel values, helped by the time
+   * values of the data list blocks if the file stores them. Only a few records
+   * are read to find the range.
+   *
+   * Only sorted MDF4 data groups (one channel group) with fixed length records
+   * and an increasing master channel are supported.
+   * @param data_group Data group to read.
+   * @param start_time Start master value, normally in seconds.
+   * @param end_time End master value, normally in seconds.
+   * @return True on success.
+   */
+  bool ReadTimeRange(const IDataGroup& data_group, double start_time, double end_time);
+
+  /** \brief Reads the samples appended since the last call (follow mode).
+   *
+   * Used when tailing a file that is still being written. The reader remembers
+   * how many data bytes of the data group that have been read. Each call parses
+   * only the new complete records and notifies the sample observers, which
+   * grow with the new samples. The first call reads all existing samples. The
+   * end of data is found from the DT block length or, for an unfinished file
+   * where the last DT block length isn't updated (flag 0x04), from the end of
+   * the file if the DT block is the last block in the file.
+   *
+   * Only MDF4 data groups with a single DT block, and VLSD channels with a
+   * single SD block, are supported. The file handle is kept between the
+   * calls unless the handle policy is OpenPerCall. A memory mapped file is
+   * followed through a file stream, as the mapping doesn't see the appended
+   * bytes.
+   * @param data_group Data group to read.
+   * @return True on success.
+   */
+  bool ReadNewData(const IDataGroup& data_group);
 
  private:
-  std::FILE *file_ = nullptr; ///< Pointer to the file stream.
+  std::unique_ptr<std::streambuf> file_; ///< Pointer to the file stream buffer.
+  std::unique_ptr<std::streambuf> follow_file_; ///< File stream that follows a mapped file.
   std::string filename_; ///< The file name with full path.
+  MdfReaderOptions options_; ///< File access options.
+  std::span<const uint8_t> buffer_; ///< Caller-owned file buffer (memory backend).
+  std::unique_ptr<detail::BlockArena> arena_; ///< Block memory. Must be destroyed after the file object.
   std::unique_ptr<MdfFile> instance_; ///< Pointer to the MDF file object.
+  std::map<const IDataGroup*, uint64_t> consumed_list_; ///< Data bytes read in follow mode.
   int64_t index_ = 0; ///< Unique (database) file index that can be used to identify a file instead of its path.
 
+  /// Returns a function that opens a stream buffer with its own file position.
+  [[nodiscard]] std::function<std::unique_ptr<std::streambuf>()> MakeFileOpener() const;
+  /// Sets up on demand reading of the channel blocks.
+  void CreateLazyFile();
+  /// Reads the ID block and creates the MDF3 or MDF4 file object.
+  void CreateInstance();
+  /// Reads a sample range of the data group through a file stream buffer.
+  bool ReadData(const IDataGroup& data_group, std::streambuf& file,
+                size_t first_sample, size_t nof_samples) const;
+  /// Reads a time range of the data group through a file stream buffer.
+  bool ReadTimeRange(const IDataGroup& data_group, std::streambuf& file,
+                     double start_time, double end_time) const;
+  /// Creates a stream buffer with its own file position if the backend supports it.
+  [[nodiscard]] std::unique_ptr<std::streambuf> CreateCursor() const;
+  /// Opens the file if not open. Returns true if the file shall be closed after the call.
+  bool OpenForCall();
 };
 }
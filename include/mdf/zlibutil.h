@@ -8,6 +8,7 @@
 
 #pragma once
 #include <cstdio>
+#include <streambuf>
 #include <vector>
 #include <string>
 
@@ -54,10 +55,72 @@ bool Deflate(const std::string& filename, ByteArray& buf_out); ///< Compress arr
 
 bool Inflate(std::FILE* in, std::FILE* out); ///< Decompress file to file.
 bool Inflate(std::FILE* in, std::FILE* out, uint64_t nof_bytes); ///< Decompress part of file to file
+bool Inflate(std::streambuf& in, std::streambuf& out, uint64_t nof_bytes); ///< Decompress part of stream to stream
+/**
+ * Decompress a byte array directly to another array.
+ *
+ * The output array shall be sized to the decompressed size, for example the
+ * original data length of a DZ block. The input is then decompressed in one
+ * call. The output array is resized to the decompressed size.
+ * @param in Input byte array with compressed data.
+ * @param out Output array.
+ * @return True on success.
+ */
 bool Inflate(const ByteArray& in, ByteArray& out); ///< Decompress array to array.
+
+/**
+ * Decompress a memory buffer directly into a destination buffer.
+ *
+ * Same as the array version but the destination may be a part of a larger
+ * buffer, which avoids an extra copy.
+ * @param in Compressed data.
+ * @param in_size Number of compressed bytes.
+ * @param out Destination buffer.
+ * @param out_size Size of the destination buffer. Returns the number of
+ * decompressed bytes.
+ * @return True on success.
+ */
+bool Inflate(const uint8_t* in, size_t in_size, uint8_t* out, size_t& out_size);
 bool Inflate(const ByteArray& in, std::FILE* out); ///< Decompress array to file.
 
+/**
+ * Returns the name of the deflate codec that the library was built with,
+ * "zlib", "zlib-ng" or "libdeflate". See the CMake option MDF_DEFLATE_BACKEND.
+ * @return Name of the codec.
+ */
+[[nodiscard]] std::string DeflateBackend();
+
 void Transpose(ByteArray& data, size_t record_size); ///< Transpose of an array.
 void InvTranspose(ByteArray& data, size_t record_size); ///< Invert transpose of an array.
 
+/**
+ * Transpose of an array into another array.
+ *
+ * The records are transposed so all first bytes of the records come first,
+ * then all second bytes and so on. Bytes after the last complete record
+ * aren't transposed but copied as is, which is how a DZ block stores them.
+ * SSE2 and AVX2 kernels are used if the compiler targets them.
+ * @param in Input array.
+ * @param out Output array. The function resizes it to the input size.
+ * @param record_size Number of bytes in a record.
+ */
+void Transpose(const ByteArray& in, ByteArray& out, size_t record_size);
+
+/**
+ * Invert transpose of an array into another array. See Transpose().
+ * @param in Transposed input array.
+ * @param out Output array. The function resizes it to the input size.
+ * @param record_size Number of bytes in a record.
+ */
+void InvTranspose(const ByteArray& in, ByteArray& out, size_t record_size);
+
+/**
+ * Invert transpose of a memory buffer into another buffer. See Transpose().
+ * @param in Transposed input bytes.
+ * @param out Destination with room for size bytes. It shall not overlap the input.
+ * @param size Number of bytes.
+ * @param record_size Number of bytes in a record.
+ */
+void InvTranspose(const uint8_t* in, uint8_t* out, size_t size, size_t record_size);
+
 }
@@ -0,0 +1,21 @@
+# Copyright 2022 Ingemar Hedvall
+# SPDX-License-Identifier: MIT
+
+if (NOT DEFLATE_FOUND)
+    if (MDF_DEFLATE_BACKEND STREQUAL "zlib-ng")
+        find_path(DEFLATE_INCLUDE_DIR zlib-ng.h)
+        find_library(DEFLATE_LIBRARY NAMES z-ng zlib-ng)
+    elseif (MDF_DEFLATE_BACKEND STREQUAL "libdeflate")
+        find_path(DEFLATE_INCLUDE_DIR libdeflate.h)
+        find_library(DEFLATE_LIBRARY NAMES deflate libdeflate)
+    endif()
+    if (DEFLATE_INCLUDE_DIR AND DEFLATE_LIBRARY)
+        set(DEFLATE_FOUND TRUE)
+    else()
+        set(DEFLATE_FOUND FALSE)
+    endif()
+    message(STATUS "Deflate Backend: " ${MDF_DEFLATE_BACKEND})
+    message(STATUS "Deflate Found: " ${DEFLATE_FOUND})
+    message(STATUS "Deflate Include Dirs: " ${DEFLATE_INCLUDE_DIR})
+    message(STATUS "Deflate Libraries: " ${DEFLATE_LIBRARY})
+endif()
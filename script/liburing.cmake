@@ -0,0 +1,15 @@
+# Copyright 2022 Ingemar Hedvall
+# SPDX-License-Identifier: MIT
+
+if (NOT URING_FOUND)
+    find_path(URING_INCLUDE_DIR liburing.h)
+    find_library(URING_LIBRARY uring)
+    if (URING_INCLUDE_DIR AND URING_LIBRARY)
+        set(URING_FOUND TRUE)
+    else()
+        set(URING_FOUND FALSE)
+    endif()
+    message(STATUS "liburing Found: " ${URING_FOUND})
+    message(STATUS "liburing Include Dirs: " ${URING_INCLUDE_DIR})
+    message(STATUS "liburing Libraries: " ${URING_LIBRARY})
+endif()
@@ -3,6 +3,8 @@
  * SPDX-License-Identifier: MIT
  */
 #include <filesystem>
+#include <fstream>
+#include <algorithm>
 #include <sstream>
 #include <cerrno>
 #include "at4block.h"
@@ -20,6 +22,7 @@ constexpr size_t kIndexNext = 0;
 constexpr size_t kIndexFilename = 1;
 constexpr size_t kIndexType = 2;
 constexpr size_t kIndexMd = 3;
+constexpr size_t kCopyChunk = 16384;
 
 std::string MakeFlagString(uint16_t flag) {
   std::ostringstream s;
@@ -35,15 +38,18 @@ std::string MakeFlagString(uint16_t flag) {
   return s.str();
 }
 
-bool CopyBytes(std::FILE* source, std::FILE* dest, uint64_t nof_bytes) {
-  uint8_t temp = 0;
-  for (uint64_t ii = 0; ii < nof_bytes; ++ii) {
-    if (fread(&temp, 1, 1, source) != 1) {
+bool CopyBytes(std::streambuf& source, std::streambuf& dest, uint64_t nof_bytes) {
+  std::vector<char> temp(kCopyChunk, 0);
+  for (uint64_t count = 0; count < nof_bytes; ) {
+    const auto bytes = static_cast<std::streamsize>(
+        std::min<uint64_t>(kCopyChunk, nof_bytes - count));
+    if (source.sgetn(temp.data(), bytes) != bytes) {
       return false;
     }
-    if (fwrite(&temp, 1, 1, dest) != 1) {
+    if (dest.sputn(temp.data(), bytes) != bytes) {
       return false;
     }
+    count += static_cast<uint64_t>(bytes);
   }
   return true;
 }
@@ -129,7 +135,7 @@ void At4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t At4Block::Read(std::FILE *file) {
+size_t At4Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader4(file);
   bytes += ReadNumber(file, flags_);
   bytes += ReadNumber(file, creator_index_);
@@ -217,19 +223,20 @@ size_t At4Block::Write(std::FILE *file) {
   return bytes;
 }
 
-void At4Block::ReadData(std::FILE *file, const std::string &dest_file) const {
-  if (file == nullptr || data_position_ <= 0) {
-    throw std::invalid_argument("File is not opened or data position not read");
+void At4Block::ReadData(std::streambuf& file, const std::string &dest_file) const {
+  if (data_position_ <= 0) {
+    throw std::invalid_argument("Data position not read");
   }
   SetFilePosition(file,data_position_);
   if (IsEmbedded()) {
-    auto* dest = fopen(dest_file.c_str(), "wb");
-    if (dest == nullptr) {
+    std::filebuf dest;
+    if (dest.open(dest_file, std::ios_base::out | std::ios_base::trunc |
+                  std::ios_base::binary) == nullptr) {
       throw std::ios_base::failure("Failed to open the destination file");
     }
     const bool error = IsCompressed() ? !Inflate(file,dest,nof_bytes_)
         : !CopyBytes(file, dest, nof_bytes_);
-     fclose(dest);
+    dest.close();
     if (error) {
       throw std::ios_base::failure("Failed to copy correct number of bytes");
     }
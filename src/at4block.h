@@ -36,9 +36,9 @@ class At4Block : public IBlock, public IAttachment {
   [[nodiscard]] bool IsCompressed() const override;
 
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
 
-  void ReadData(std::FILE *file, const std::string& dest_file) const;
+  void ReadData(std::streambuf& file, const std::string& dest_file) const;
 
   size_t Write(std::FILE *file) override;
   [[nodiscard]] std::optional<std::string> Md5() const override;
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#include <new>
+#include "blockarena.h"
+
+namespace {
+
+constexpr size_t kInitialSize = 64 * 1024; ///< First arena buffer size.
+
+/// The header before each block object tells if the memory is from an arena.
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+constexpr unsigned char kHeapBlock = 0;
+constexpr unsigned char kArenaBlock = 1;
+
+thread_local mdf::detail::BlockArena* current_arena = nullptr;
+
+}  // namespace
+
+namespace mdf::detail {
+
+BlockArena::BlockArena()
+    : resource_(kInitialSize) {
+}
+
+BlockArena::Scope::Scope(BlockArena *arena)
+    : previous_(current_arena) {
+  current_arena = arena;
+}
+
+BlockArena::Scope::~Scope() {
+  current_arena = previous_;
+}
+
+BlockArena *BlockArena::Current() {
+  return current_arena;
+}
+
+void *BlockArena::AllocateBlock(size_t size) {
+  auto* arena = Current();
+  auto* memory = static_cast<unsigned char*>(arena != nullptr ?
+      arena->allocate(size + kHeaderSize, kHeaderSize) : ::operator new(size + kHeaderSize));
+  *memory = arena != nullptr ? kArenaBlock : kHeapBlock;
+  return memory + kHeaderSize;
+}
+
+void BlockArena::FreeBlock(void *block) {
+  if (block == nullptr) {
+    return;
+  }
+  auto* memory = static_cast<unsigned char*>(block) - kHeaderSize;
+  if (*memory == kHeapBlock) {
+    ::operator delete(memory);
+  }
+}
+
+void *BlockArena::do_allocate(size_t bytes, size_t alignment) {
+  std::lock_guard lock(locker_);
+  return resource_.allocate(bytes, alignment);
+}
+
+void BlockArena::do_deallocate(void*, size_t, size_t) {
+  // The memory is released when the arena is destroyed
+}
+
+bool BlockArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+  return this == &other;
+}
+
+}  // namespace mdf::detail
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+namespace mdf::detail {
+
+/** \class BlockArena blockarena.h "blockarena.h"
+ * \brief Memory arena for the block objects of one file.
+ *
+ * The block objects are allocated from the arena while an arena scope is
+ * active in the calling thread, see Scope. The memory is taken from a few
+ * large buffers and is released all at once when the arena is destroyed.
+ * This makes building and releasing a large block tree much faster than
+ * one heap allocation per block.
+ *
+ * The arena must outlive all blocks allocated from it. Blocks created
+ * without an active scope use the heap as before.
+ */
+class BlockArena : public std::pmr::memory_resource {
+ public:
+  BlockArena();
+
+  /** \class Scope blockarena.h "blockarena.h"
+   * \brief Uses an arena for block allocations in the current thread.
+   *
+   * The previous arena is restored when the scope ends. A null arena
+   * means heap allocation.
+   */
+  class Scope {
+   public:
+    explicit Scope(BlockArena* arena);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+   private:
+    BlockArena* previous_ = nullptr;
+  };
+
+  [[nodiscard]] static BlockArena* Current(); ///< Arena of the calling thread or null.
+
+  /** \brief Allocates memory for a block object.
+   *
+   * The memory is taken from the current arena if any, otherwise from the
+   * heap. Used by the block class operator new.
+   * @param size Number of bytes.
+   * @return Pointer to the memory.
+   */
+  [[nodiscard]] static void* AllocateBlock(size_t size);
+
+  /// Frees memory from AllocateBlock(). Arena memory is freed with the arena.
+  static void FreeBlock(void* block);
+
+ protected:
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* block, size_t bytes, size_t alignment) override;
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+ private:
+  std::mutex locker_; ///< Blocks may be read in different threads.
+  std::pmr::monotonic_buffer_resource resource_;
+};
+
+}  // namespace mdf::detail
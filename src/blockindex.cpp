@@ -0,0 +1,62 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#include <algorithm>
+#include "blockindex.h"
+#include "iblock.h"
+
+namespace mdf::detail {
+
+void BlockIndex::Add(const IBlock *block) {
+  if (block == nullptr || block->FilePosition() <= 0) {
+    return;
+  }
+  std::lock_guard lock(locker_);
+  // The first block is kept if a block is read twice
+  index_.emplace(block->FilePosition(), block);
+  last_position_ = std::max(last_position_, block->FilePosition());
+}
+
+void BlockIndex::Remove(const IBlock *block) {
+  if (block == nullptr) {
+    return;
+  }
+  std::lock_guard lock(locker_);
+  auto itr = index_.find(block->FilePosition());
+  if (itr != index_.end() && itr->second == block) {
+    index_.erase(itr);
+  }
+}
+
+const IBlock *BlockIndex::Find(int64_t position) const {
+  std::lock_guard lock(locker_);
+  auto itr = index_.find(position);
+  return itr != index_.end() ? itr->second : nullptr;
+}
+
+int64_t BlockIndex::LastPosition() const {
+  std::lock_guard lock(locker_);
+  return last_position_;
+}
+
+std::shared_ptr<IBlock> BlockIndex::FindShared(int64_t position) const {
+  std::lock_guard lock(locker_);
+  auto itr = shared_index_.find(position);
+  return itr != shared_index_.end() ? itr->second.lock() : std::shared_ptr<IBlock>();
+}
+
+std::shared_ptr<IBlock> BlockIndex::AddShared(const std::shared_ptr<IBlock> &block) {
+  if (!block || block->FilePosition() <= 0) {
+    return block;
+  }
+  std::lock_guard lock(locker_);
+  auto& shared = shared_index_[block->FilePosition()];
+  if (auto existing = shared.lock(); existing) {
+    return existing;
+  }
+  shared = block;
+  return block;
+}
+
+}  // namespace mdf::detail
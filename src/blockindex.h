@@ -0,0 +1,69 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace mdf::detail {
+
+class IBlock;
+
+/** \class BlockIndex blockindex.h "blockindex.h"
+ * \brief Index of all blocks in a file by their file position.
+ *
+ * The blocks register themselves when they are read or written and
+ * unregister when they are destroyed. This gives a constant time lookup of
+ * a block by its link, instead of searching through the block tree.
+ * The index is owned by the MDF file object.
+ *
+ * The index also keeps track of blocks that are shared by many blocks, as
+ * the conversion and source blocks of the channels. A referenced block is
+ * then only read once. The index doesn't own the shared blocks.
+ */
+class BlockIndex {
+ public:
+  void Add(const IBlock* block); ///< Adds the block at its file position.
+  void Remove(const IBlock* block); ///< Removes the block if it is indexed.
+
+  /** \brief Returns the block at a file position.
+   *
+   * @param position File position of the block.
+   * @return Pointer to the block or null if not found.
+   */
+  [[nodiscard]] const IBlock* Find(int64_t position) const;
+
+  /** \brief Returns the highest file position of the added blocks.
+   *
+   * Follow mode uses this to find if a data block is the last block in the
+   * file, which is the only block that may grow.
+   * @return File position of the last known block.
+   */
+  [[nodiscard]] int64_t LastPosition() const;
+
+  /** \brief Returns the shared block at a file position.
+   *
+   * @param position File position of the block.
+   * @return The block or null if no block is shared at the position.
+   */
+  [[nodiscard]] std::shared_ptr<IBlock> FindShared(int64_t position) const;
+
+  /** \brief Shares a block at its file position.
+   *
+   * If another block already is shared at the position, that block is
+   * returned instead. This happens if two threads read the same block.
+   * @param block Block to share.
+   * @return The shared block.
+   */
+  std::shared_ptr<IBlock> AddShared(const std::shared_ptr<IBlock>& block);
+ private:
+  mutable std::mutex locker_; ///< Blocks may be read in different threads.
+  std::unordered_map<int64_t, const IBlock*> index_;
+  int64_t last_position_ = 0; ///< Highest file position of the added blocks.
+  std::unordered_map<int64_t, std::weak_ptr<IBlock>> shared_index_;
+};
+
+}  // namespace mdf::detail
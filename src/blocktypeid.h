@@ -0,0 +1,56 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace mdf::detail {
+
+/** \class BlockTypeId blocktypeid.h "blocktypeid.h"
+ * \brief Block type stored in place, as "CN" or "##CN".
+ *
+ * The block type has at most 4 characters. A std::string member costs 32
+ * bytes in every block object, while this class fits in 5 bytes. The class
+ * converts to a std::string, so it can be used as the string it replaces.
+ */
+class BlockTypeId {
+ public:
+  static constexpr size_t kMaxSize = 4;
+
+  BlockTypeId() = default;
+  BlockTypeId(std::string_view type) { // NOLINT
+    *this = type;
+  }
+
+  BlockTypeId& operator=(std::string_view type) {
+    size_ = static_cast<uint8_t>(std::min(type.size(), kMaxSize));
+    std::fill(std::begin(type_), std::end(type_), '\0');
+    std::copy_n(type.cbegin(), size_, type_);
+    return *this;
+  }
+
+  operator std::string() const { // NOLINT
+    return {type_, size_};
+  }
+
+  bool operator==(std::string_view type) const {
+    return std::string_view(type_, size_) == type;
+  }
+
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+  [[nodiscard]] size_t size() const { return size_; }
+  char operator[](size_t index) const { return type_[index]; }
+
+  [[nodiscard]] std::string substr(size_t pos) const {
+    return pos < size_ ? std::string(type_ + pos, size_ - pos) : std::string();
+  }
+ private:
+  char type_[kMaxSize] = {};
+  uint8_t size_ = 0;
+};
+
+}  // namespace mdf::detail
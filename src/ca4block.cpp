@@ -77,18 +77,19 @@ void Ca4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Ca4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, type_);
-  bytes += ReadNumber(file, storage_);
-  bytes += ReadNumber(file, dimension_);
-  bytes += ReadNumber(file, flags_);
-  bytes += ReadNumber(file, byte_offset_base_);
-  bytes += ReadNumber(file, invalid_bit_pos_base_);
+size_t Ca4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, type_);
+  bytes += ReadNumber(data, storage_);
+  bytes += ReadNumber(data, dimension_);
+  bytes += ReadNumber(data, flags_);
+  bytes += ReadNumber(data, byte_offset_base_);
+  bytes += ReadNumber(data, invalid_bit_pos_base_);
   dim_size_list_.clear();
   for (uint16_t dd = 0; dd < dimension_; ++dd) {
     uint64_t size = 0;
-    bytes += ReadNumber(file, size);
+    bytes += ReadNumber(data, size);
     dim_size_list_.push_back(size);
   }
   axis_value_list_.clear();
@@ -97,7 +98,7 @@ size_t Ca4Block::Read(std::FILE *file) {
       uint64_t size = dim_size_list_[dd];
       for (uint64_t ss = 0; ss < size; ++ss) {
         double temp = 0;
-        bytes += ReadNumber(file, temp);
+        bytes += ReadNumber(data, temp);
         axis_value_list_.push_back(temp);
       }
     }
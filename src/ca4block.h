@@ -23,7 +23,7 @@ class Ca4Block : public IBlock , public IChannelArray {
   [[nodiscard]] uint32_t Flags() const override;
 
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
 
  private:
   uint8_t type_ = 0;
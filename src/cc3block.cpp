@@ -169,7 +169,7 @@ void Cc3Block::GetBlockProperty(BlockPropertyList &dest) const {
 
 
 
-size_t Cc3Block::Read(std::FILE *file) {
+size_t Cc3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadBool(file, range_valid_);
   bytes += ReadNumber(file, min_);
@@ -39,7 +39,7 @@ class Cc3Block : public IBlock, public IChannelConversion {
   [[nodiscard]] uint8_t Decimals() const override;
 
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
  protected:
   bool ConvertValueToText(double channel_value, std::string& eng_value) const override;
@@ -197,20 +197,21 @@ void Cc4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Cc4Block::Read(std::FILE *file) { // NOLINT
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, type_);
-  bytes += ReadNumber(file, precision_);
-  bytes += ReadNumber(file, flags_);
-  bytes += ReadNumber(file, nof_references_);
-  bytes += ReadNumber(file, nof_values_);
-  bytes += ReadNumber(file, range_min_);
-  bytes += ReadNumber(file, range_max_);
+size_t Cc4Block::Read(std::streambuf& file) { // NOLINT
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, type_);
+  bytes += ReadNumber(data, precision_);
+  bytes += ReadNumber(data, flags_);
+  bytes += ReadNumber(data, nof_references_);
+  bytes += ReadNumber(data, nof_values_);
+  bytes += ReadNumber(data, range_min_);
+  bytes += ReadNumber(data, range_max_);
 
   value_list_.clear();
   for (uint16_t ii = 0; ii < nof_values_; ++ii) {
     double temp = 0;
-    bytes += ReadNumber(file, temp);
+    bytes += ReadNumber(data, temp);
     value_list_.push_back(temp);
   }
 
@@ -61,7 +61,7 @@ namespace mdf::detail {
   [[nodiscard]] const IBlock* Find(fpos_t index) const override;
   void GetBlockProperty(BlockPropertyList& dest) const override;
 
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
 
  protected:
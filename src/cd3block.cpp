@@ -4,7 +4,7 @@
  */
 #include "cd3block.h"
 namespace mdf::detail {
-size_t Cd3Block::Read(std::FILE *file) {
+size_t Cd3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadNumber(file, dependency_type_);
   bytes += ReadNumber(file, nof_dependencies_);
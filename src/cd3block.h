@@ -15,7 +15,7 @@ struct Dependency {
 
 class Cd3Block : public IBlock {
  public:
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
  private:
   uint16_t dependency_type_ = 0;
   uint16_t nof_dependencies_ = 0;
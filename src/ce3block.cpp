@@ -5,7 +5,7 @@
 #include "ce3block.h"
 
 namespace mdf::detail {
-size_t Ce3Block::Read(std::FILE *file) {
+size_t Ce3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadNumber(file, type_);
   switch (type_) {
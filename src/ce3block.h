@@ -11,7 +11,7 @@
 namespace mdf::detail {
 class Ce3Block : public IBlock {
  public:
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
  private:
   uint16_t type_ = 0;
 
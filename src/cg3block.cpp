@@ -86,7 +86,7 @@ void Cg3Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Comment", comment_);
 }
 
-size_t Cg3Block::Read(std::FILE *file) {
+size_t Cg3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadLinks3(file, 3);
 
@@ -174,7 +174,7 @@ size_t Cg3Block::Write(std::FILE *file) {
   return bytes;
 }
 
-void Cg3Block::ReadCnList(std::FILE *file) {
+void Cg3Block::ReadCnList(std::streambuf& file) {
   if (cn_list_.empty() && Link(kIndexCn) > 0) {
     for (auto link = Link(kIndexCn); link > 0; /* No ++ here*/) {
       auto cn = std::make_unique<Cn3Block>();
@@ -187,7 +187,7 @@ void Cg3Block::ReadCnList(std::FILE *file) {
   }
 }
 
-void Cg3Block::ReadSrList(std::FILE *file) {
+void Cg3Block::ReadSrList(std::streambuf& file) {
   if (sr_list_.empty() && Link(kIndexSr) > 0) {
     for (auto link = Link(kIndexSr); link > 0; /* No ++ here*/) {
       auto sr = std::make_unique<Sr3Block>();
@@ -232,13 +232,11 @@ void Cg3Block::PrepareForWriting() {
   sample_buffer_.resize(size_of_data_record_);
 }
 
-size_t Cg3Block::ReadDataRecord(std::FILE *file, const IDataGroup& notifier) const {
-  size_t count = 0;
-
+size_t Cg3Block::ReadDataRecord(const uint8_t* data, std::vector<uint8_t>& record,
+                                const IDataGroup& notifier) const {
   // Normal fixed length records
-  size_t record_size = size_of_data_record_;
-  std::vector<uint8_t> record(record_size,0);
-  count = std::fread(record.data(), 1, record.size(), file);
+  const size_t count = size_of_data_record_;
+  record.assign(data, data + count);
   size_t sample = Sample();
   if (sample < NofSamples()) {
     notifier.NotifySampleObservers(sample,RecordId(), record);
@@ -35,10 +35,10 @@ class Cg3Block : public IBlock , public IChannelGroup {
   [[nodiscard]] std::string Comment() const override;
   const IBlock* Find(fpos_t index) const override;
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
-  void ReadCnList(std::FILE* file);
-  void ReadSrList(std::FILE* file);
+  void ReadCnList(std::streambuf& file);
+  void ReadSrList(std::streambuf& file);
 
   uint16_t RecordSize() const {
     return size_of_data_record_;
@@ -58,7 +58,16 @@ class Cg3Block : public IBlock , public IChannelGroup {
   [[nodiscard]] std::vector<uint8_t>& SampleBuffer() const {
     return sample_buffer_;
   }
-  size_t ReadDataRecord(std::FILE* file, const IDataGroup& notifier) const;
+  /** \brief Notifies the observers about a data record in memory.
+   *
+   * @param data Record bytes after the record ID. All RecordSize() bytes
+   * must be available.
+   * @param record Reused buffer that the observers get the record in.
+   * @param notifier Data group with the sample observers.
+   * @return Number of bytes in the record.
+   */
+  size_t ReadDataRecord(const uint8_t* data, std::vector<uint8_t>& record,
+                        const IDataGroup& notifier) const;
  private:
 
   uint16_t record_id_ = 0;
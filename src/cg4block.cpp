@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <ranges>
 #include <cuchar>
+#include <boost/endian/conversion.hpp>
+#include "util/logstream.h"
 #include "cg4block.h"
 
 
@@ -36,6 +38,8 @@ std::string MakeFlagString(uint16_t flag) {
 
 } // end namespace
 
+using namespace util::log;
+
 namespace mdf::detail {
 
 int64_t Cg4Block::Index() const {
@@ -51,7 +55,7 @@ std::string Cg4Block::Name() const {
 }
 
 void Cg4Block::Description(const std::string &description) {
-  md_comment_ = std::make_unique<Md4Block>(description);
+  MdComment(std::make_unique<Md4Block>(description));
 }
 
 std::string Cg4Block::Description() const {
@@ -75,6 +79,7 @@ const IChannel *Cg4Block::GetXChannel(const IChannel &reference) const {
   // First check if the channel have a dedicated X channel reference
   auto x_axis_list = cn4->XAxisLinkList();
   // As we are returning a channel pointer, we must assume that it belongs to this group
+  LoadLazy();
   if (x_axis_list.size() == 3 && x_axis_list[1] == Index() && x_axis_list[2]) {
     const auto channel_index = x_axis_list[2];
     auto find = std::ranges::find_if(cn_list_,[&] (const auto& p)  {
@@ -103,6 +108,7 @@ const IChannel *Cg4Block::GetXChannel(const IChannel &reference) const {
 
 void Cg4Block::GetBlockProperty(BlockPropertyList &dest) const {
   IBlock::GetBlockProperty(dest);
+  LoadLazy();
 
   dest.emplace_back("Links", "", "", BlockItemType::HeaderItem);
   dest.emplace_back("Next CG", ToHexString(Link(kIndexNext)), "Link to next channel group", BlockItemType::LinkItem );
@@ -136,16 +142,17 @@ void Cg4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Cg4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, record_id_);
-  bytes += ReadNumber(file, nof_samples_);
-  bytes += ReadNumber(file, flags_);
-  bytes += ReadNumber(file, path_separator_);
+size_t Cg4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, record_id_);
+  bytes += ReadNumber(data, nof_samples_);
+  bytes += ReadNumber(data, flags_);
+  bytes += ReadNumber(data, path_separator_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 4);
-  bytes += ReadNumber(file, nof_data_bytes_);
-  bytes += ReadNumber(file, nof_invalid_bytes_);
+  bytes += ReadByte(data, reserved, 4);
+  bytes += ReadNumber(data, nof_data_bytes_);
+  bytes += ReadNumber(data, nof_invalid_bytes_);
 
   acquisition_name_ = ReadTx4(file, kIndexName);
   if (Link(kIndexSi) > 0) {
@@ -190,15 +197,38 @@ size_t Cg4Block::Write(std::FILE *file) {
   return bytes;
 }
 
-void Cg4Block::ReadCnList(std::FILE *file) {
+void Cg4Block::ReadCnList(std::streambuf& file) {
   ReadLink4List(file, cn_list_, kIndexCn);
 }
 
-void Cg4Block::ReadSrList(std::FILE *file) {
+void Cg4Block::ReadSrList(std::streambuf& file) {
   ReadLink4List(file, sr_list_, kIndexSr);
 }
 
+void Cg4Block::SetLazyFile(const LazyFile *lazy_file) {
+  lazy_file_ = lazy_file;
+}
+
+void Cg4Block::LoadLazy() const {
+  if (lazy_file_ == nullptr) {
+    return;
+  }
+  std::call_once(lazy_flag_, [&] {
+    // The block is never created as a const object, so the cast is safe.
+    auto* cg4 = const_cast<Cg4Block*>(this);
+    try {
+      lazy_file_->Read([cg4] (std::streambuf& file) {
+        cg4->ReadCnList(file);
+        cg4->ReadSrList(file);
+      });
+    } catch (const std::exception& error) {
+      LOG_ERROR() << "Failed to read the channel list. Error: " << error.what();
+    }
+  });
+}
+
 const IBlock *Cg4Block::Find(fpos_t index) const {
+  LoadLazy();
   if (si_block_) {
     const auto* p = si_block_->Find(index);
     if (p != nullptr) {
@@ -228,36 +258,43 @@ const IBlock *Cg4Block::Find(fpos_t index) const {
   return IBlock::Find(index);
 }
 
-size_t Cg4Block::ReadDataRecord(std::FILE *file, const IDataGroup& notifier) const {
+size_t Cg4Block::FixedRecordSize() const {
+  return (flags_ & CgFlag::VlsdChannel) == 0 ? nof_data_bytes_ + nof_invalid_bytes_ : 0;
+}
+
+size_t Cg4Block::NextRecordSize(const uint8_t* data, size_t available) const {
+  if ((flags_ & CgFlag::VlsdChannel) == 0) {
+    return nof_data_bytes_ + nof_invalid_bytes_;
+  }
+  if (available < sizeof(uint32_t)) {
+    return 0;
+  }
+  return sizeof(uint32_t) + boost::endian::load_little_u32(data);
+}
+
+size_t Cg4Block::ReadDataRecord(const uint8_t* data, std::vector<uint8_t>& record,
+                                const IDataGroup& notifier) const {
   size_t count = 0;
   if (flags_ & CgFlag::VlsdChannel) {
     // This is normally used for string and the CG block only include one signal
-    uint32_t length = 0;
-    count += ReadNumber(file, length);
-    std::vector<uint8_t> record(length,0);
-    if (length > 0) {
-      count += std::fread(record.data(), 1, length, file);
-    }
-    size_t sample = Sample();
-    if (sample < NofSamples()) {
-      notifier.NotifySampleObservers(sample,RecordId(), record);
-      IncrementSample();
-    }
+    const auto length = boost::endian::load_little_u32(data);
+    count = sizeof(uint32_t) + length;
+    record.assign(data + sizeof(uint32_t), data + count);
   } else {
     // Normal fixed length records
-    size_t record_size = nof_data_bytes_ + nof_invalid_bytes_;
-    std::vector<uint8_t> record(record_size,0);
-    count = std::fread(record.data(), 1, record.size(), file);
-    size_t sample = Sample();
-    if (sample < NofSamples()) {
-      notifier.NotifySampleObservers(sample,RecordId(), record);
-      IncrementSample();
-    }
+    count = nof_data_bytes_ + nof_invalid_bytes_;
+    record.assign(data, data + count);
+  }
+  size_t sample = Sample();
+  if (sample < NofSamples()) {
+    notifier.NotifySampleObservers(sample,RecordId(), record);
+    IncrementSample();
   }
   return count;
 }
 
 std::vector<IChannel *> Cg4Block::Channels() const {
+   LoadLazy();
    std::vector<IChannel *> channel_list;
    std::ranges::for_each(cn_list_, [&] (const auto& cn3) {channel_list.push_back(cn3.get()); } );
    return channel_list;
@@ -6,12 +6,14 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include "iblock.h"
 #include "mdf/ichannelgroup.h"
 #include "mdf/idatagroup.h"
 #include "si4block.h"
 #include "cn4block.h"
 #include "sr4block.h"
+#include "lazyfile.h"
 
 namespace mdf::detail {
 
@@ -25,10 +27,12 @@ class Cg4Block : public IBlock, public IChannelGroup {
 
   void AddCn4(std::unique_ptr<Cn4Block>& cn3);
   [[nodiscard]] const Cn4List& Cn4() const {
+    LoadLazy();
     return cn_list_;
   }
 
   [[nodiscard]] const Sr4List& Sr4() const {
+    LoadLazy();
     return sr_list_;
   }
 
@@ -59,11 +63,43 @@ class Cg4Block : public IBlock, public IChannelGroup {
     return si_block_.get();
   }
 
-  size_t Read(std::FILE *file) override;
-  void ReadCnList(std::FILE* file);
-  void ReadSrList(std::FILE* file);
+  size_t Read(std::streambuf& file) override;
+  void ReadCnList(std::streambuf& file);
+  void ReadSrList(std::streambuf& file);
+
+  /** \brief Defers the reading of the CN and SR blocks.
+   *
+   * The channel and sample reduction lists are read the first time
+   * they are accessed. The channels also defer their conversion, source,
+   * unit and comment blocks.
+   * @param lazy_file File access used when the blocks are read.
+   */
+  void SetLazyFile(const LazyFile* lazy_file);
+  [[nodiscard]] const LazyFile* GetLazyFile() const {
+    return lazy_file_;
+  }
 
-  size_t ReadDataRecord(std::FILE* file, const IDataGroup& notifier) const;
+  /** \brief Returns the size of a fixed length record, or 0 for VLSD records. */
+  [[nodiscard]] size_t FixedRecordSize() const;
+  /** \brief Returns the size of the next data record, excluding the record ID.
+   *
+   * A VLSD record size is read from its length field.
+   * @param data Record bytes after the record ID.
+   * @param available Number of bytes in memory.
+   * @return The record size or 0 if the length field isn't available.
+   */
+  [[nodiscard]] size_t NextRecordSize(const uint8_t* data, size_t available) const;
+
+  /** \brief Notifies the observers about a data record in memory.
+   *
+   * @param data Record bytes after the record ID. All NextRecordSize() bytes
+   * must be available.
+   * @param record Reused buffer that the observers get the record in.
+   * @param notifier Data group with the sample observers.
+   * @return Number of bytes in the record.
+   */
+  size_t ReadDataRecord(const uint8_t* data, std::vector<uint8_t>& record,
+                        const IDataGroup& notifier) const;
   std::vector<uint8_t>& SampleBuffer() const {
     return sample_buffer_;
   }
@@ -84,6 +120,11 @@ class Cg4Block : public IBlock, public IChannelGroup {
   std::unique_ptr<Si4Block> si_block_;
   Cn4List cn_list_;
   Sr4List sr_list_;
+
+  const LazyFile* lazy_file_ = nullptr; ///< Set if the lists are read on demand.
+  mutable std::once_flag lazy_flag_;
+
+  void LoadLazy() const; ///< Reads the CN and SR lists if deferred.
 };
 
 } // namespace mdf::detail
@@ -43,13 +43,14 @@ void Ch4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Ch4Block::Read(std::FILE *file) { //NOLINT
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, nof_elements_);
-  bytes += ReadNumber(file, type_);
+size_t Ch4Block::Read(std::streambuf& file) { //NOLINT
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, nof_elements_);
+  bytes += ReadNumber(data, type_);
 
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file,reserved,3);
+  bytes += ReadByte(data,reserved,3);
 
   name_ = ReadTx4(file,kIndexTx);
   ReadMdComment(file,kIndexMd);
@@ -123,7 +124,7 @@ ChType Ch4Block::Type() const {
 }
 
 void Ch4Block::Description(const std::string &description) {
-  md_comment_ = std::make_unique<Md4Block>(description);
+  MdComment(std::make_unique<Md4Block>(description));
 }
 
 std::string Ch4Block::Description() const {
@@ -132,11 +133,11 @@ std::string Ch4Block::Description() const {
 
 IMetaData *Ch4Block::MetaData() {
   CreateMd4Block();
-  return dynamic_cast<IMetaData *>(md_comment_.get());
+  return dynamic_cast<IMetaData *>(MdComment());
 }
 
 const IMetaData *Ch4Block::MetaData() const {
-  return !md_comment_ ? nullptr : dynamic_cast<IMetaData *>(md_comment_.get());
+  return !md_comment_ ? nullptr : dynamic_cast<const IMetaData *>(md_comment_.get());
 }
 
 void Ch4Block::AddElementLink(const ElementLink &element) {
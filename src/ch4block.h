@@ -41,7 +41,7 @@ class Ch4Block : public IBlock, public IChannelHierarchy {
   [[nodiscard]] const IBlock* Find(fpos_t index) const override;
 
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
   void FindReferencedBlocks(const Hd4Block &hd4);
 
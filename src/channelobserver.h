@@ -16,10 +16,12 @@ template <class T>
 class ChannelObserver : public IChannelObserver {
  private:
   uint64_t record_id_ = 0;
+  size_t first_sample_ = 0; ///< Sample index of value_list_[0].
   std::vector<T> value_list_;
   std::vector<bool> valid_list_;
 
   const IDataGroup& data_group_; ///< Reference to the publisher (subject/observer)
+  const IChannelGroup& group_;
 
 
   template<typename V>
@@ -49,6 +51,7 @@ class ChannelObserver : public IChannelObserver {
   ChannelObserver(const IDataGroup& data_group, const IChannelGroup& group, const IChannel& channel)
   : IChannelObserver(channel),
     data_group_(data_group),
+    group_(group),
     record_id_(group.RecordId()),
     value_list_(group.NofSamples(), T {}),
     valid_list_(group.NofSamples(), false) {
@@ -68,20 +71,49 @@ class ChannelObserver : public IChannelObserver {
     return std::min(valid_list_.size(),value_list_.size());
   }
 
+  [[nodiscard]] size_t FirstSample() const override {
+    return first_sample_;
+  }
+
+  [[nodiscard]] bool IsRecordIdNeeded(uint64_t record_id) const override {
+    return record_id_ == record_id;
+  }
+
+  void OnSampleRange(size_t first_sample, size_t nof_samples) override {
+    // Only the samples in the range are stored
+    const auto total = group_.NofSamples();
+    const auto first = std::min(first_sample, total);
+    const auto count = std::min(nof_samples, total - first);
+    if (first == first_sample_ && count == value_list_.size() && count == valid_list_.size()) {
+      return;
+    }
+    first_sample_ = first;
+    value_list_.assign(count, T {});
+    value_list_.shrink_to_fit();
+    valid_list_.assign(count, false);
+    valid_list_.shrink_to_fit();
+  }
+
   void OnSample(size_t sample, uint64_t record_id, const std::vector<uint8_t>& record) override {
-    if (record_id_ != record_id ) {
+    if (record_id_ != record_id || sample < first_sample_) {
       return;
     }
+    const auto index = sample - first_sample_;
+    if (index >= value_list_.size()) {
+      // Follow mode adds samples after the observer was created
+      value_list_.resize(index + 1, T {});
+      valid_list_.resize(index + 1, false);
+    }
     switch (channel_.Type()) {
       case ChannelType::VirtualMaster:
       case ChannelType::VirtualData: {
         T value {};
         const bool valid = GetVirtualSample(sample, value);
-        if (sample < value_list_.size()) {
-          value_list_[sample] = value;
+        if (index < value_list_.size()) {
+          value_list_[index] = value;
         }
-        if (sample < valid_list_.size()) {
-          valid_list_[sample] = valid;
+        if (index < valid_list_.size()) {
+          valid_list_[index] = valid;
         }
         break;
       }
@@ -94,11 +126,11 @@ class ChannelObserver : public IChannelObserver {
       default: {
         T value {};
         const bool valid = channel_.GetChannelValue(record, value);
-        if (sample < value_list_.size()) {
-          value_list_[sample] = value;
+        if (index < value_list_.size()) {
+          value_list_[index] = value;
         }
-        if (sample < valid_list_.size()) {
-          valid_list_[sample] = valid;
+        if (index < valid_list_.size()) {
+          valid_list_[index] = valid;
         }
         break;
       }
@@ -165,7 +165,7 @@ void Cn3Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Byte Offset", std::to_string(byte_offset_));
 }
 
-size_t Cn3Block::Read(std::FILE *file) {
+size_t Cn3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadLinks3(file, 5);
   bytes += ReadNumber(file, channel_type_);
@@ -267,7 +267,7 @@ size_t Cn3Block::Write(std::FILE *file) {
     bytes += WriteNumber(file, sample_rate_);
     bytes += WriteNumber(file, static_cast<uint32_t>(long_name_link));
     bytes += WriteNumber(file, static_cast<uint32_t>(display_name_link));
-    bytes += ReadNumber(file, byte_offset_);
+    bytes += WriteNumber(file, byte_offset_);
   }
 
   if (cc_block_ && Link(kIndexCc) <= 0) {
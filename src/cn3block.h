@@ -54,7 +54,7 @@ class Cn3Block : public DataListBlock , public IChannel {
   [[nodiscard]] const IBlock* Find(fpos_t index) const override;
   void GetBlockProperty(BlockPropertyList& dest) const override;
   void Init(const IBlock &id_block) override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
 
   void AddCc3(std::unique_ptr<Cc3Block>& cc3);
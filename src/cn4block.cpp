@@ -2,12 +2,15 @@
  * Copyright 2021 Ingemar Hedvall
  * SPDX-License-Identifier: MIT
  */
+#include <algorithm>
+#include <stdexcept>
 #include <string>
 #include <ctime>
 #define BOOST_NO_AUTO_PTR
 #include <boost/endian/conversion.hpp>
 #include <boost/endian/buffers.hpp>
 #include <boost/locale.hpp>
+#include "util/logstream.h"
 #include "cn4block.h"
 #include "ca4block.h"
 #include "sd4block.h"
@@ -122,7 +125,7 @@ std::string MakeFlagString(uint32_t flag) {
 
 ///< Helper function that recursively copies all data bytes to a
 /// destination buffer.
-size_t CopyDataToBuffer( const mdf::detail::IBlock* data, std::FILE* from_file,
+size_t CopyDataToBuffer( const mdf::detail::IBlock* data, std::streambuf& from_file,
                          std::vector<uint8_t>& buffer, size_t& buffer_index ) {
   if (data == nullptr) {
     return 0;
@@ -142,8 +145,17 @@ size_t CopyDataToBuffer( const mdf::detail::IBlock* data, std::FILE* from_file,
 
 } // end namespace
 
+using namespace util::log;
+
 namespace mdf::detail {
 
+// A file may hold millions of CN blocks, so their size is checked. On a 64-bit
+// release build a CN block was 416 bytes plus an 80 byte heap link list. With
+// the optional properties and the links stored in place it is 368 bytes.
+static_assert(sizeof(void*) != 8 || sizeof(std::string) != 32 ||
+              sizeof(std::vector<uint8_t>) != 24 || sizeof(Cn4Block) <= 368,
+              "The CN block has grown");
+
 Cn4Block::Cn4Block() {
   block_type_ = "##CN";
 }
@@ -188,14 +200,42 @@ std::string Cn4Block::DisplayName() const {
 }
 
 void Cn4Block::Description(const std::string &description) {
-  md_comment_ = std::make_unique<Md4Block>(description);
+  LoadLazy(); // A deferred read would otherwise replace the new comment
+  MdComment(std::make_unique<Md4Block>(description));
 }
 
 std::string Cn4Block::Description() const {
+  LoadLazy();
   return MdText();
 }
 
+std::string Cn4Block::Comment() const {
+  LoadLazy();
+  return IBlock::Comment();
+}
+
+const Md4Block* Cn4Block::Md4() const {
+  LoadLazy();
+  return IBlock::Md4();
+}
+
+std::string Cn4Block::MdText() const {
+  LoadLazy();
+  return IBlock::MdText();
+}
+
+IMetaData* Cn4Block::MetaData() {
+  LoadLazy();
+  return IBlock::MetaData();
+}
+
+const IMetaData* Cn4Block::MetaData() const {
+  LoadLazy();
+  return IBlock::MetaData();
+}
+
 const IChannelConversion *Cn4Block::ChannelConversion() const {
+  LoadLazy();
   return cc_block_.get();
 }
 ChannelDataType Cn4Block::DataType() const {
@@ -222,6 +262,7 @@ bool Cn4Block::IsUnitValid() const {
 }
 
 std::string Cn4Block::Unit() const {
+  LoadLazy();
   if (!unit_) {
     return {};
   }
@@ -233,6 +274,7 @@ std::string Cn4Block::Unit() const {
 
 void Cn4Block::GetBlockProperty(BlockPropertyList &dest) const {
   IBlock::GetBlockProperty(dest);
+  LoadLazy();
 
   dest.emplace_back("Links", "", "", BlockItemType::HeaderItem);
   dest.emplace_back("Next CN", ToHexString(Link(kIndexNext)), "Link to next channel", BlockItemType::LinkItem );
@@ -266,92 +308,136 @@ void Cn4Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Invalid Bit Position", std::to_string(invalid_bit_pos_));
   dest.emplace_back("Decimals", std::to_string(precision_));
   dest.emplace_back("Nof Attachments", std::to_string(nof_attachments_));
-  dest.emplace_back("Range Min", ToString(range_min_));
-  dest.emplace_back("Range Max", ToString(range_max_));
-  dest.emplace_back("Limit Min", ToString(limit_min_));
-  dest.emplace_back("Limit Max", ToString(limit_max_));
-  dest.emplace_back("Extended Limit Min", ToString(limit_ext_min_));
-  dest.emplace_back("Extended Limit Max", ToString(limit_ext_max_));
+  const Cn4Optional no_optional;
+  const auto& optional = optional_ ? *optional_ : no_optional;
+  dest.emplace_back("Range Min", ToString(optional.range_min));
+  dest.emplace_back("Range Max", ToString(optional.range_max));
+  dest.emplace_back("Limit Min", ToString(optional.limit_min));
+  dest.emplace_back("Limit Max", ToString(optional.limit_max));
+  dest.emplace_back("Extended Limit Min", ToString(optional.limit_ext_min));
+  dest.emplace_back("Extended Limit Max", ToString(optional.limit_ext_max));
 
   if (md_comment_) {
     md_comment_->GetBlockProperty(dest);
   }
 }
 
-size_t Cn4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, type_);
-  bytes += ReadNumber(file, sync_type_);
-  bytes += ReadNumber(file, data_type_);
-  bytes += ReadNumber(file, bit_offset_);
-  bytes += ReadNumber(file, byte_offset_);
-  bytes += ReadNumber(file, bit_count_);
-  bytes += ReadNumber(file, flags_);
-  bytes += ReadNumber(file, invalid_bit_pos_);
-  bytes += ReadNumber(file, precision_);
+size_t Cn4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, type_);
+  bytes += ReadNumber(data, sync_type_);
+  bytes += ReadNumber(data, data_type_);
+  bytes += ReadNumber(data, bit_offset_);
+  bytes += ReadNumber(data, byte_offset_);
+  bytes += ReadNumber(data, bit_count_);
+  bytes += ReadNumber(data, flags_);
+  bytes += ReadNumber(data, invalid_bit_pos_);
+  bytes += ReadNumber(data, precision_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 1);
-  bytes += ReadNumber(file, nof_attachments_);
-  bytes += ReadNumber(file, range_min_);
-  bytes += ReadNumber(file, range_max_);
-  bytes += ReadNumber(file, limit_min_);
-  bytes += ReadNumber(file, limit_max_);
-  bytes += ReadNumber(file, limit_ext_min_);
-  bytes += ReadNumber(file, limit_ext_max_);
-
-  name_ = ReadTx4(file, kIndexName);
-
-  if (Link(kIndexCx) > 0) {
+  bytes += ReadByte(data, reserved, 1);
+  bytes += ReadNumber(data, nof_attachments_);
+  Cn4Optional limits;
+  bytes += ReadNumber(data, limits.range_min);
+  bytes += ReadNumber(data, limits.range_max);
+  bytes += ReadNumber(data, limits.limit_min);
+  bytes += ReadNumber(data, limits.limit_max);
+  bytes += ReadNumber(data, limits.limit_ext_min);
+  bytes += ReadNumber(data, limits.limit_ext_max);
+  if (limits.range_min != 0 || limits.range_max != 0 || limits.limit_min != 0 ||
+      limits.limit_max != 0 || limits.limit_ext_min != 0 || limits.limit_ext_max != 0) {
+    optional_ = std::make_unique<Cn4Optional>(std::move(limits));
+  }
+
+  // The referenced blocks are independent, so they are read in file order
+  std::vector<ReadJob> job_list;
+  job_list.emplace_back(Link(kIndexName), [&] { name_ = ReadTx4(file, kIndexName); });
+
+  job_list.emplace_back(Link(kIndexCx), [&] {
     SetFilePosition(file, Link(kIndexCx));
     auto block_type = ReadBlockType(file);
 
     SetFilePosition(file, Link(kIndexCx));
+    auto& cx_block = Optional().cx_block;
     if (block_type == "CA") {
-      cx_block_ = std::make_unique<Ca4Block>();
-      cx_block_->Init(*this);
-      cx_block_->Read(file);
+      cx_block = std::make_unique<Ca4Block>();
+      cx_block->Init(*this);
+      cx_block->Read(file);
     } else if (block_type == "CN") {
-      cx_block_ = std::make_unique<Cn4Block>();
-      cx_block_->Init(*this);
-      cx_block_->Read(file);
+      cx_block = std::make_unique<Cn4Block>();
+      cx_block->Init(*this);
+      cx_block->Read(file);
     }
-  }
-
-  if (Link(kIndexSi) > 0) {
-    SetFilePosition(file, Link(kIndexSi));
-    si_block_ = std::make_unique<Si4Block>();
-    si_block_->Init(*this);
-    si_block_->Read(file);
-  }
-
-  if (Link(kIndexCc) > 0) {
-    SetFilePosition(file, Link(kIndexCc));
-    cc_block_ = std::make_unique<Cc4Block>();
-    cc_block_->Init(*this);
-    cc_block_->ChannelDataType(data_type_);
-    cc_block_->Read(file);
-  }
+  });
 
   // Need ot check if the data block is owned by this CN block or if it is a reference only
-  ReadBlockList(file, kIndexData);
-
-  if (Link(kIndexUnit) > 0) {
-    SetFilePosition(file, Link(kIndexUnit));
-    unit_ = std::make_unique<Md4Block>();
-    unit_->Init(*this);
-    unit_->Read(file);
+  job_list.emplace_back(Link(kIndexData), [&] { ReadBlockList(file, kIndexData); });
+  if (lazy_file_ == nullptr) {
+    AddMetadataJobs(file, job_list);
   }
-  ReadMdComment(file,kIndexMd);
+  ReadInFileOrder(file, job_list);
 
   return bytes;
 }
 
+void Cn4Block::AddMetadataJobs(std::streambuf& file, std::vector<ReadJob>& job_list) {
+  job_list.emplace_back(Link(kIndexSi), [&] {
+    si_block_ = ReadSharedBlock4<Si4Block>(file, kIndexSi);
+  });
+  job_list.emplace_back(Link(kIndexCc), [&] {
+    // The conversion depends on the channel data type, so it is only
+    // shared by channels with the same data type.
+    auto shared = FindShared<Cc4Block>(Link(kIndexCc));
+    if (shared && shared->ChannelDataType() == data_type_) {
+      cc_block_ = std::move(shared);
+      return;
+    }
+    SetFilePosition(file, Link(kIndexCc));
+    auto* arena = BlockArena::Current();
+    auto cc4 = arena != nullptr ?
+        std::allocate_shared<Cc4Block>(std::pmr::polymorphic_allocator<Cc4Block>(arena)) :
+        std::make_shared<Cc4Block>();
+    cc4->Init(*this);
+    cc4->ChannelDataType(data_type_);
+    cc4->Read(file);
+    if (!shared) {
+      shared = AddShared(cc4);
+    }
+    cc_block_ = shared && shared->ChannelDataType() == data_type_ ? shared : cc4;
+  });
+  job_list.emplace_back(Link(kIndexUnit), [&] {
+    unit_ = ReadSharedBlock4<Md4Block>(file, kIndexUnit);
+  });
+  job_list.emplace_back(Link(kIndexMd), [&] { ReadMdComment(file,kIndexMd); });
+}
+
+void Cn4Block::LoadLazy() const {
+  if (lazy_file_ == nullptr) {
+    return;
+  }
+  std::call_once(lazy_flag_, [&] {
+    // The block is never created as a const object, so the cast is safe.
+    auto* cn4 = const_cast<Cn4Block*>(this);
+    try {
+      lazy_file_->Read([cn4] (std::streambuf& file) {
+        std::vector<ReadJob> job_list;
+        cn4->AddMetadataJobs(file, job_list);
+        ReadInFileOrder(file, job_list);
+      });
+    } catch (const std::exception& error) {
+      LOG_ERROR() << "Failed to read the channel information. Error: " << error.what();
+    }
+  });
+}
+
 size_t Cn4Block::Write(std::FILE *file) {
   const bool update = FilePosition() > 0; // True if already written to file
   if (update) {
     return block_length_;
   }
-  nof_attachments_ = attachment_list_.size();
+  const Cn4Optional no_optional;
+  const auto& optional = optional_ ? *optional_ : no_optional;
+  nof_attachments_ = optional.attachment_list.size();
   const auto default_x = (flags_ & CnFlag::DefaultX) != 0;
 
   block_type_ = "##CN";
@@ -362,23 +448,25 @@ size_t Cn4Block::Write(std::FILE *file) {
   }
   block_length_ += 1 + 1 + 1 + 1 + 4 + 4 + 4 + 4 + 1 + 1 + 2 + (6*8);
   link_list_.resize(8 + nof_attachments_ + (default_x ? 1 : 0),0);
-  WriteBlock4(file, cx_block_, kIndexCx);
+  if (optional_) {
+    WriteBlock4(file, optional_->cx_block, kIndexCx);
+  }
   WriteTx4(file, kIndexName, name_);
   WriteBlock4(file, si_block_, kIndexSi);
   WriteBlock4(file, cc_block_, kIndexCc);
   // ToDo: Signal data needs to be fixed
   WriteBlock4(file, unit_, kIndexUnit);
   WriteMdComment(file,  kIndexMd);
-  for (size_t index_at = 0; index_at <attachment_list_.size(); ++index_at) {
+  for (size_t index_at = 0; index_at < optional.attachment_list.size(); ++index_at) {
     const auto index = 8 + index_at;
-    const auto* at4 = attachment_list_[index_at];
+    const auto* at4 = optional.attachment_list[index_at];
     link_list_[index] =at4 != nullptr ? at4->Index() : 0;
   }
   if (default_x) {
     const auto index = 8 + nof_attachments_;
-    const auto* dg4 = default_x_.data_group;
-    const auto* cg4 = default_x_.channel_group;
-    const auto* cn4 = default_x_.channel;
+    const auto* dg4 = optional.default_x.data_group;
+    const auto* cg4 = optional.default_x.channel_group;
+    const auto* cn4 = optional.default_x.channel;
     link_list_[index] = dg4 != nullptr ? dg4->Index() : 0;
     link_list_[index] = cg4 != nullptr ? cg4->Index() : 0;
     link_list_[index] = cn4 != nullptr ? cn4->Index() : 0;
@@ -396,17 +484,18 @@ size_t Cn4Block::Write(std::FILE *file) {
   bytes += WriteNumber(file, precision_);;
   bytes += WriteBytes(file, 1);
   bytes += WriteNumber(file, nof_attachments_);
-  bytes += WriteNumber(file, range_min_);
-  bytes += WriteNumber(file, range_max_);
-  bytes += WriteNumber(file, limit_min_);
-  bytes += WriteNumber(file, limit_max_);
-  bytes += WriteNumber(file, limit_ext_min_);
-  bytes += WriteNumber(file, limit_ext_max_);
+  bytes += WriteNumber(file, optional.range_min);
+  bytes += WriteNumber(file, optional.range_max);
+  bytes += WriteNumber(file, optional.limit_min);
+  bytes += WriteNumber(file, optional.limit_max);
+  bytes += WriteNumber(file, optional.limit_ext_min);
+  bytes += WriteNumber(file, optional.limit_ext_max);
   UpdateBlockSize(file, bytes);
   return bytes;
 }
 
 const IBlock *Cn4Block::Find(fpos_t index) const {
+  LoadLazy();
   if (si_block_) {
     const auto* p = si_block_->Find(index);
     if (p != nullptr) {
@@ -428,8 +517,8 @@ const IBlock *Cn4Block::Find(fpos_t index) const {
     }
   }
 
-  if (cx_block_) {
-    const auto* p = cx_block_->Find(index);
+  if (const auto* cx_block = Cx(); cx_block != nullptr) {
+    const auto* p = cx_block->Find(index);
     if (p != nullptr) {
       return p;
     }
@@ -438,7 +527,7 @@ const IBlock *Cn4Block::Find(fpos_t index) const {
   return DataListBlock::Find(index);
 }
 
-void Cn4Block::ReadData(std::FILE *file) const {
+void Cn4Block::ReadData(std::streambuf& file) const {
   size_t count = 0;
   for (const auto& b : DataBlockList()) {
     const auto *dl = dynamic_cast<const DataListBlock *>(b.get());
@@ -462,6 +551,41 @@ void Cn4Block::ReadData(std::FILE *file) const {
     }
   }
 }
+
+void Cn4Block::ReadNewData(std::streambuf& file) const {
+  const auto sd_position = ReadDataLink(file);
+  if (sd_position <= 0) {
+    return;
+  }
+  uint64_t block_length = 0;
+  uint64_t nof_links = 0;
+  const auto block_type = ReadBlockHeader4(file, sd_position, block_length, nof_links);
+  if (block_type == "##CG") {
+    return; // The VLSD records are stored in the data group
+  }
+  if (block_type != "##SD") {
+    throw std::runtime_error("Follow mode requires a single SD block");
+  }
+  const auto header_size = 24 + (nof_links * 8);
+  if (block_length <= header_size) {
+    return;
+  }
+  const auto data_size = static_cast<size_t>(block_length - header_size);
+  const auto index = data_list_.size();
+  if (data_size <= index) {
+    return;
+  }
+  data_list_.resize(data_size);
+  SetFilePosition(file, sd_position + static_cast<int64_t>(header_size + index));
+  const auto count = file.sgetn(reinterpret_cast<char*>(data_list_.data() + index),
+                                static_cast<std::streamsize>(data_size - index));
+  data_list_.resize(index + static_cast<size_t>(std::max<std::streamsize>(count, 0)));
+}
+
+int64_t Cn4Block::ReadDataLink(std::streambuf& file) const {
+  return ReadLink4(file, kIndexData);
+}
+
 size_t Cn4Block::BitCount() const {
   return bit_count_;
 }
@@ -598,6 +722,7 @@ std::vector<uint8_t> &Cn4Block::SampleBuffer() const {
 void Cn4Block::Init(const IBlock &id_block) {
   IBlock::Init(id_block);
   cg_block_ = dynamic_cast<const Cg4Block*>(&id_block);
+  lazy_file_ = cg_block_ != nullptr ? cg_block_->GetLazyFile() : nullptr;
 }
 
 void Cn4Block::AddCc4(std::unique_ptr<Cc4Block> &cc4) {
@@ -613,36 +738,53 @@ ChannelSyncType Cn4Block::Sync() const {
 }
 
 void Cn4Block::Range(double min, double max) {
-  range_min_ = min;
-  range_max_ = max;
+  auto& optional = Optional();
+  optional.range_min = min;
+  optional.range_max = max;
   flags_ |= CnFlag::RangeValid;
 }
 
 std::optional<std::pair<double, double>> Cn4Block::Range() const {
-  return (flags_ & CnFlag::RangeValid) != 0 ?
-      std::optional(std::pair(range_min_, range_max_)) : IChannel::Range();
+  if ((flags_ & CnFlag::RangeValid) == 0) {
+    return IChannel::Range();
+  }
+  return optional_ ? std::pair(optional_->range_min, optional_->range_max) : std::pair(0.0, 0.0);
 }
 
 void Cn4Block::Limit(double min, double max) {
-  limit_min_ = min;
-  limit_max_ = max;
+  auto& optional = Optional();
+  optional.limit_min = min;
+  optional.limit_max = max;
   flags_ |= CnFlag::LimitValid;
 }
 
 std::optional<std::pair<double, double>> Cn4Block::Limit() const {
-  return (flags_ & CnFlag::LimitValid) != 0 ?
-         std::optional(std::pair(limit_min_, limit_max_)) : IChannel::Limit();
+  if ((flags_ & CnFlag::LimitValid) == 0) {
+    return IChannel::Limit();
+  }
+  return optional_ ? std::pair(optional_->limit_min, optional_->limit_max) : std::pair(0.0, 0.0);
 }
 
 void Cn4Block::ExtLimit(double min, double max) {
-  limit_ext_min_ = min;
-  limit_ext_max_ = max;
+  auto& optional = Optional();
+  optional.limit_ext_min = min;
+  optional.limit_ext_max = max;
   flags_ |= CnFlag::ExtendedLimitValid;
 }
 
 std::optional<std::pair<double, double>> Cn4Block::ExtLimit() const {
-  return (flags_ & CnFlag::ExtendedLimitValid) != 0 ?
-         std::optional(std::pair(limit_ext_min_, limit_ext_max_)) : IChannel::Limit();
+  if ((flags_ & CnFlag::ExtendedLimitValid) == 0) {
+    return IChannel::Limit();
+  }
+  return optional_ ? std::pair(optional_->limit_ext_min, optional_->limit_ext_max) :
+                     std::pair(0.0, 0.0);
+}
+
+Cn4Optional &Cn4Block::Optional() {
+  if (!optional_) {
+    optional_ = std::make_unique<Cn4Optional>();
+  }
+  return *optional_;
 }
 
 
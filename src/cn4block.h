@@ -3,6 +3,7 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <mutex>
 #include <string>
 #include "datalistblock.h"
 #include "mdf/ichannel.h"
@@ -15,6 +16,26 @@
 
 namespace mdf::detail {
 class Cg4Block;
+class LazyFile;
+
+/** \brief Optional channel properties.
+ *
+ * Most channels don't use the range and limits, composition, attachments
+ * or a default X-axis. These properties are stored in a separate object
+ * that only is created when needed. This keeps the channel block small in
+ * files with many channels.
+ */
+struct Cn4Optional {
+  double range_min = 0;
+  double range_max = 0;
+  double limit_min = 0;
+  double limit_max = 0;
+  double limit_ext_min = 0;
+  double limit_ext_max = 0;
+  std::unique_ptr<IBlock> cx_block; ///< Composition CA or CN block.
+  std::vector<const IAttachment*> attachment_list;
+  ElementLink default_x;
+};
 
 class Cn4Block : public DataListBlock , public IChannel {
  public:
@@ -54,23 +75,45 @@ class Cn4Block : public DataListBlock , public IChannel {
 
   void GetBlockProperty(BlockPropertyList& dest) const override;
   [[nodiscard]] const IBlock* Find(fpos_t index) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
 
   void Init(const IBlock &id_block) override;
+  [[nodiscard]] std::string Comment() const override;
+  using IBlock::Md4;
+  [[nodiscard]] const Md4Block* Md4() const override;
 
   [[nodiscard]] const IBlock* Cx() const {
-    return cx_block_.get();
+    return optional_ ? optional_->cx_block.get() : nullptr;
   }
 
   [[nodiscard]] const Si4Block* Si() const {
+    LoadLazy();
     return si_block_.get();
   }
   void AddCc4(std::unique_ptr<Cc4Block>& cc4);
   [[nodiscard]] const Cc4Block* Cc() const {
+    LoadLazy();
     return cc_block_.get();
   }
-  void ReadData(std::FILE* file) const; ///< Reads in (VLSD) channel data
+  void ReadData(std::streambuf& file) const; ///< Reads in (VLSD) channel data
+
+  /** \brief Reads the VLSD data appended since the last call.
+   *
+   * Follow mode. The SD block is found from the link in the file, so an SD
+   * block added or grown after the file was opened is read. Only the bytes
+   * beyond the already read data are read. Only a single SD block is supported.
+   * @param file File to read from.
+   */
+  void ReadNewData(std::streambuf& file) const;
+
+  /** \brief Reads the data link from the file.
+   *
+   * Follow mode. The writer may add the SD block after the file was opened.
+   * @param file File to read from.
+   * @return File position of the SD block or 0.
+   */
+  [[nodiscard]] int64_t ReadDataLink(std::streambuf& file) const;
 
   void ClearData() const {
     data_list_.clear();
@@ -96,6 +139,9 @@ class Cn4Block : public DataListBlock , public IChannel {
   size_t ByteOffset() const override; ///< Returns byte offset in record.
   bool GetTextValue(const std::vector<uint8_t> &record_buffer, std::string &dest) const override;
   std::vector<uint8_t> &SampleBuffer() const override;
+  [[nodiscard]] std::string MdText() const override;
+  [[nodiscard]] IMetaData* MetaData() override;
+  [[nodiscard]] const IMetaData* MetaData() const override;
  private:
   uint8_t type_ = 0;
   uint8_t sync_type_ = 0;
@@ -108,23 +154,23 @@ class Cn4Block : public DataListBlock , public IChannel {
   uint8_t precision_ = 0;
   /* 1 byte reserved */
   uint16_t nof_attachments_ = 0;
-  double range_min_ = 0;
-  double range_max_ = 0;
-  double limit_min_ = 0;
-  double limit_max_ = 0;
-  double limit_ext_min_ = 0;
-  double limit_ext_max_ = 0;
 
   std::string name_;
-  std::unique_ptr<Si4Block> si_block_;
-  std::unique_ptr<Cc4Block> cc_block_;
-  std::unique_ptr<Md4Block> unit_;
-  std::unique_ptr<IBlock> cx_block_;
-  std::vector<const IAttachment*> attachment_list_;
-  ElementLink default_x_;
+  // The SI, CC and unit blocks are often shared by many channels
+  std::shared_ptr<Si4Block> si_block_;
+  std::shared_ptr<Cc4Block> cc_block_;
+  std::shared_ptr<Md4Block> unit_;
+  std::unique_ptr<Cn4Optional> optional_; ///< Null if no optional properties.
 
   mutable std::vector<uint8_t> data_list_;
   const Cg4Block* cg_block_ = nullptr;
+
+  const LazyFile* lazy_file_ = nullptr; ///< Set if the SI, CC, unit and MD blocks are read on demand.
+  mutable std::once_flag lazy_flag_;
+
+  Cn4Optional& Optional(); ///< Creates the optional properties if missing.
+  void LoadLazy() const; ///< Reads the deferred blocks.
+  void AddMetadataJobs(std::streambuf& file, std::vector<ReadJob>& job_list);
 };
 
 }
@@ -7,11 +7,7 @@
 namespace mdf::detail
 {
 
-size_t DataBlock::CopyDataToFile(std::FILE *from_file, std::FILE *to_file) const {
-  if (from_file == nullptr || to_file == nullptr) {
-    throw std::invalid_argument("File pointers may not be null");
-  }
-
+size_t DataBlock::CopyDataToFile(std::streambuf& from_file, std::streambuf& to_file) const {
   SetFilePosition(from_file, DataPosition());
 
   auto data_size = DataSize();
@@ -19,12 +15,12 @@ size_t DataBlock::CopyDataToFile(std::FILE *from_file, std::FILE *to_file) const
     return 0;
   }
   size_t count = 0;
-  std::array<uint8_t, 10'000> temp {};
+  std::array<char, 10'000> temp {};
   size_t bytes_to_read = std::min(data_size, temp.size());
-  for (auto reads = fread(temp.data(),1,bytes_to_read,from_file);
+  for (auto reads = static_cast<size_t>(from_file.sgetn(temp.data(), static_cast<std::streamsize>(bytes_to_read)));
        reads > 0 && bytes_to_read > 0 && data_size > 0;
-       reads = fread(temp.data(),1, bytes_to_read, from_file)) {
-      const auto writes = fwrite(temp.data(), 1, reads, to_file);
+       reads = static_cast<size_t>(from_file.sgetn(temp.data(), static_cast<std::streamsize>(bytes_to_read)))) {
+      const auto writes = static_cast<size_t>(to_file.sputn(temp.data(), static_cast<std::streamsize>(reads)));
       count += writes;
       if (writes != reads) {
         break;
@@ -36,16 +32,15 @@ size_t DataBlock::CopyDataToFile(std::FILE *from_file, std::FILE *to_file) const
   return count;
 }
 
-size_t DataBlock::CopyDataToBuffer(std::FILE *from_file, std::vector<uint8_t> &buffer, size_t& buffer_index) const {
-  if (from_file == nullptr) {
-    throw std::invalid_argument("File pointers may not be null");
-  }
+size_t DataBlock::CopyDataToBuffer(std::streambuf& from_file, std::vector<uint8_t> &buffer, size_t& buffer_index) const {
   SetFilePosition(from_file, DataPosition());
   const auto data_size = DataSize();
   if (data_size == 0) {
     return 0;
   }
-  const auto reads = fread(buffer.data() + buffer_index,1,data_size,from_file);
+  const auto reads = static_cast<size_t>(from_file.sgetn(
+      reinterpret_cast<char*>(buffer.data() + buffer_index),
+      static_cast<std::streamsize>(data_size)));
   buffer_index += reads;
   return reads;
 }
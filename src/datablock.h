@@ -14,8 +14,12 @@ class DataBlock : public IBlock {
     return data_position_;
   }
   [[nodiscard]] virtual size_t DataSize() const = 0;
-  virtual size_t CopyDataToFile(std::FILE* from_file, std::FILE* to_file) const;
-  virtual size_t CopyDataToBuffer(std::FILE* from_file, std::vector<uint8_t>& buffer, size_t& buffer_index) const;
+  /// Number of data bytes stored in the file. Differs from DataSize() for compressed blocks.
+  [[nodiscard]] virtual size_t StoredSize() const {
+    return DataSize();
+  }
+  virtual size_t CopyDataToFile(std::streambuf& from_file, std::streambuf& to_file) const;
+  virtual size_t CopyDataToBuffer(std::streambuf& from_file, std::vector<uint8_t>& buffer, size_t& buffer_index) const;
  protected:
   fpos_t data_position_ = 0;
 };
@@ -23,7 +23,7 @@ namespace {
 
 namespace mdf::detail {
 
-void DataListBlock::ReadBlockList(std::FILE *file, size_t data_index) {
+void DataListBlock::ReadBlockList(std::streambuf& file, size_t data_index) {
   if (block_list_.empty() && Link(data_index) > 0) {
     SetFilePosition(file, Link(data_index));
     std::string block_type = ReadBlockType(file);
@@ -105,58 +105,66 @@ void DataListBlock::ReadBlockList(std::FILE *file, size_t data_index) {
   }
 }
 
-void DataListBlock::ReadLinkList(std::FILE *file, size_t data_index, uint32_t nof_link) {
+void DataListBlock::ReadLinkList(std::streambuf& file, size_t data_index, uint32_t nof_link) {
   if (block_list_.empty()) {
+    // The data blocks are read in file order but the list keeps the link order
+    BlockList temp_list(nof_link);
+    std::vector<ReadJob> job_list;
     for (uint32_t ii = 0; ii < nof_link; ++ii) {
       auto link = Link(data_index + ii);
-      if (link <= 0) {
-        continue;
-      }
-      SetFilePosition(file, link);
-      std::string block_type = ReadBlockType(file);
+      job_list.emplace_back(link, [&, ii, link] {
+        SetFilePosition(file, link);
+        std::string block_type = ReadBlockType(file);
 
-      SetFilePosition(file, link);
-      if (block_type == "DT") {
-        auto dt = std::make_unique<Dt4Block>();
-        dt->Init(*this);
-        dt->Read(file);
-        block_list_.emplace_back(std::move(dt));
-      } else if (block_type == "DZ") {
-        auto dz = std::make_unique<Dz4Block>();
-        dz->Init(*this);
-        dz->Read(file);
-        block_list_.emplace_back(std::move(dz));
-      } else if (block_type == "DV") {
-        auto dv_block = std::make_unique<Dv4Block>();
-        dv_block->Init(*this);
-        dv_block->Read(file);
-        block_list_.emplace_back(std::move(dv_block));
-      } else if (block_type == "DI") {
-        auto di_block = std::make_unique<Di4Block>();
-        di_block->Init(*this);
-        di_block->Read(file);
-        block_list_.emplace_back(std::move(di_block));
-      } else if (block_type == "RD") {
-        auto rd = std::make_unique<Rd4Block>();
-        rd->Init(*this);
-        rd->Read(file);
-        block_list_.emplace_back(std::move(rd));
-      } else if (block_type == "RV") {
-        auto rv_block = std::make_unique<Rv4Block>();
-        rv_block->Init(*this);
-        rv_block->Read(file);
-        block_list_.emplace_back(std::move(rv_block));
-      } else if (block_type == "RI") {
-        auto ri_block = std::make_unique<Ri4Block>();
-        ri_block->Init(*this);
-        ri_block->Read(file);
-        block_list_.emplace_back(std::move(ri_block));
-      } else if (block_type == "SD") {
-        auto sd = std::make_unique<Sd4Block>();
-        sd->Init(*this);
-        sd->Read(file);
-        block_list_.emplace_back(std::move(sd));
-       }
+        SetFilePosition(file, link);
+        if (block_type == "DT") {
+          auto dt = std::make_unique<Dt4Block>();
+          dt->Init(*this);
+          dt->Read(file);
+          temp_list[ii] = std::move(dt);
+        } else if (block_type == "DZ") {
+          auto dz = std::make_unique<Dz4Block>();
+          dz->Init(*this);
+          dz->Read(file);
+          temp_list[ii] = std::move(dz);
+        } else if (block_type == "DV") {
+          auto dv_block = std::make_unique<Dv4Block>();
+          dv_block->Init(*this);
+          dv_block->Read(file);
+          temp_list[ii] = std::move(dv_block);
+        } else if (block_type == "DI") {
+          auto di_block = std::make_unique<Di4Block>();
+          di_block->Init(*this);
+          di_block->Read(file);
+          temp_list[ii] = std::move(di_block);
+        } else if (block_type == "RD") {
+          auto rd = std::make_unique<Rd4Block>();
+          rd->Init(*this);
+          rd->Read(file);
+          temp_list[ii] = std::move(rd);
+        } else if (block_type == "RV") {
+          auto rv_block = std::make_unique<Rv4Block>();
+          rv_block->Init(*this);
+          rv_block->Read(file);
+          temp_list[ii] = std::move(rv_block);
+        } else if (block_type == "RI") {
+          auto ri_block = std::make_unique<Ri4Block>();
+          ri_block->Init(*this);
+          ri_block->Read(file);
+          temp_list[ii] = std::move(ri_block);
+        } else if (block_type == "SD") {
+          auto sd = std::make_unique<Sd4Block>();
+          sd->Init(*this);
+          sd->Read(file);
+          temp_list[ii] = std::move(sd);
+        }
+      });
+    }
+    ReadInFileOrder(file, job_list);
+    for (auto& block : temp_list) {
+      if (block) {
+        block_list_.emplace_back(std::move(block));
+      }
     }
   }
 }
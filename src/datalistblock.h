@@ -20,11 +20,22 @@ class DataListBlock : public IBlock {
   }
   [[nodiscard]] virtual size_t DataSize() const;
   [[nodiscard]] const IBlock* Find(fpos_t index) const override;
-  void ReadBlockList(std::FILE *file, size_t data_index );
-  void ReadLinkList(std::FILE *file, size_t data_index, uint32_t nof_link );
+  void ReadBlockList(std::streambuf& file, size_t data_index );
+  void ReadLinkList(std::streambuf& file, size_t data_index, uint32_t nof_link );
+
+  /** \brief Returns the master value of the first record in each data block.
+   *
+   * The list is empty if the block doesn't store time values. The values are
+   * raw master values, stored as int64_t or double depending on the master
+   * channel data type.
+   */
+  [[nodiscard]] const std::vector<int64_t>& TimeValues() const {
+    return time_values_;
+  }
 
  protected:
   BlockList block_list_;
+  std::vector<int64_t> time_values_; ///< Note that this actually store an int64_t or a double.
 
 };
 }
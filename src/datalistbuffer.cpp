@@ -0,0 +1,376 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#include <algorithm>
+#include <ios>
+#include "datalistbuffer.h"
+#include "dz4block.h"
+#include "positionalfile.h"
+
+namespace {
+
+constexpr size_t kChunkSize = 1024 * 1024; ///< Read size for uncompressed blocks
+constexpr size_t kBatchBlocks = 64; ///< Max number of data blocks in a batched read
+constexpr size_t kBatchBytes = 32 * 1024 * 1024; ///< Max number of bytes in a batched read
+
+///< Helper function that recursively collects the time values of the data lists.
+bool CollectTimeValues(const mdf::detail::DataListBlock::BlockList& block_list,  //NOLINT
+                       std::vector<int64_t>& dest) {
+  for (const auto& block : block_list) {
+    const auto* dl = dynamic_cast< const mdf::detail::DataListBlock* > (block.get());
+    if (dl == nullptr) {
+      continue;
+    }
+    const auto& time_list = dl->TimeValues();
+    const auto& data_list = dl->DataBlockList();
+    if (!time_list.empty() && time_list.size() == data_list.size()) {
+      dest.insert(dest.end(), time_list.cbegin(), time_list.cend());
+    } else if (!CollectTimeValues(data_list, dest)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+///< Helper function that recursively collects all data blocks in a list.
+void CollectDataBlocks(const mdf::detail::DataListBlock::BlockList& block_list,  //NOLINT
+                       std::vector<const mdf::detail::DataBlock*>& dest) {
+  for (const auto& block : block_list) {
+    if (!block) {
+      continue;
+    }
+    const auto* db = dynamic_cast< const mdf::detail::DataBlock* > (block.get());
+    const auto* dl = dynamic_cast< const mdf::detail::DataListBlock* > (block.get());
+    if (db != nullptr) {
+      dest.push_back(db);
+    } else if (dl != nullptr) {
+      CollectDataBlocks(dl->DataBlockList(), dest);
+    }
+  }
+}
+
+}  // namespace
+
+namespace mdf::detail {
+
+DataListBuffer::DataListBuffer(const DataListBlock::BlockList& block_list, std::streambuf& file)
+    : block_list_(block_list),
+      file_(file) {
+  CollectDataBlocks(block_list, data_list_);
+  const auto* positional = dynamic_cast<const PositionalFileBuffer*>(&file);
+  if (positional != nullptr && positional->File()) {
+    positional_ = positional->File().get();
+  }
+}
+
+DataListBuffer::~DataListBuffer() {
+  {
+    std::lock_guard lock(locker_);
+    stop_thread_ = true;
+  }
+  job_event_.notify_all();
+  for (auto& worker : worker_list_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+void DataListBuffer::SetInflateThreads(size_t nof_threads) {
+  inflate_threads_ = nof_threads;
+}
+
+size_t DataListBuffer::DataSize() const {
+  size_t size = 0;
+  for (const auto* block : data_list_) {
+    size += block->DataSize();
+  }
+  return size;
+}
+
+void DataListBuffer::SkipTo(uint64_t offset) {
+  size_t index = 0;
+  for (; index < data_list_.size(); ++index) {
+    const auto size = data_list_[index]->DataSize();
+    if (offset < size) {
+      break;
+    }
+    offset -= size;
+  }
+  next_block_ = index;
+  chunk_offset_ = 0;
+  skip_bytes_ = index < data_list_.size() ? static_cast<size_t>(offset) : 0;
+}
+
+const std::vector<uint64_t>& DataListBuffer::BlockOffsets() {
+  if (offset_list_.empty()) {
+    offset_list_.reserve(data_list_.size() + 1);
+    uint64_t offset = 0;
+    for (const auto* block : data_list_) {
+      offset_list_.push_back(offset);
+      offset += block->DataSize();
+    }
+    offset_list_.push_back(offset);
+  }
+  return offset_list_;
+}
+
+std::vector<int64_t> DataListBuffer::TimeValues() const {
+  std::vector<int64_t> time_list;
+  if (!CollectTimeValues(block_list_, time_list) || time_list.size() != data_list_.size()) {
+    time_list.clear();
+  }
+  return time_list;
+}
+
+size_t DataListBuffer::ReadAt(uint64_t offset, uint8_t* dest, size_t size) {
+  const auto& offset_list = BlockOffsets();
+  size_t count = 0;
+  while (count < size) {
+    // The last block that starts at or before the offset
+    const auto itr = std::upper_bound(offset_list.cbegin(), offset_list.cend(), offset);
+    if (itr == offset_list.cbegin() || itr == offset_list.cend()) {
+      break;
+    }
+    const auto index = static_cast<size_t>(itr - offset_list.cbegin()) - 1;
+    const auto* block = data_list_[index];
+    const auto within = static_cast<size_t>(offset - offset_list[index]);
+    const auto bytes = std::min(size - count, block->DataSize() - within);
+    if (dynamic_cast<const Dz4Block*>(block) != nullptr) {
+      if (cache_.empty() || cache_index_ != index) {
+        size_t decoded = 0;
+        cache_.resize(block->DataSize());
+        if (block->CopyDataToBuffer(file_, cache_, decoded) != block->DataSize()) {
+          cache_.clear(); // The block failed to decode
+          break;
+        }
+        cache_index_ = index;
+      }
+      if (within + bytes > cache_.size()) {
+        break;
+      }
+      std::copy_n(cache_.cbegin() + static_cast<int64_t>(within), bytes, dest + count);
+    } else {
+      file_.pubseekpos(block->DataPosition() + static_cast<int64_t>(within), std::ios_base::in);
+      const auto reads = file_.sgetn(reinterpret_cast<char*>(dest + count),
+                                     static_cast<std::streamsize>(bytes));
+      if (reads != static_cast<std::streamsize>(bytes)) {
+        break;
+      }
+    }
+    count += bytes;
+    offset += bytes;
+  }
+  return count;
+}
+
+bool DataListBuffer::Batched() const {
+  return positional_ != nullptr && inflate_threads_ <= 1;
+}
+
+bool DataListBuffer::Chunked(const DataBlock* block) const {
+  if (dynamic_cast<const Dz4Block*>(block) != nullptr) {
+    return false;
+  }
+  // A large block in a batch would be held twice in memory
+  return !Batched() || block->DataSize() > kChunkSize;
+}
+
+DataListBuffer::int_type DataListBuffer::underflow() {
+  while (gptr() >= egptr()) {
+    if (!NextArea()) {
+      return traits_type::eof();
+    }
+  }
+  return traits_type::to_int_type(*gptr());
+}
+
+bool DataListBuffer::NextArea() {
+  // The area keeps its memory between the blocks
+  setg(nullptr, nullptr, nullptr);
+
+  // Continue an uncompressed block that is read in chunks
+  if (next_block_ > 0 && chunk_offset_ > 0) {
+    const auto* block = data_list_[next_block_ - 1];
+    const auto remaining = block->DataSize() - chunk_offset_;
+    if (remaining > 0) {
+      area_.resize(std::min(remaining, kChunkSize));
+      file_.pubseekpos(block->DataPosition() + static_cast<int64_t>(chunk_offset_),
+                       std::ios_base::in);
+      const auto reads = file_.sgetn(reinterpret_cast<char*>(area_.data()),
+                                     static_cast<std::streamsize>(area_.size()));
+      if (reads <= 0) {
+        return false;
+      }
+      chunk_offset_ += static_cast<size_t>(reads);
+      auto* begin = reinterpret_cast<char*>(area_.data());
+      setg(begin, begin, begin + reads);
+      return true;
+    }
+  }
+
+  if (next_block_ >= data_list_.size()) {
+    return false;
+  }
+  const auto index = next_block_++;
+  chunk_offset_ = 0;
+  const auto skip = std::min(skip_bytes_, data_list_[index]->DataSize());
+  skip_bytes_ = 0;
+  const auto* block = data_list_[index];
+  const bool compressed = dynamic_cast<const Dz4Block*>(block) != nullptr;
+  size_t size = 0;
+  if (compressed && inflate_threads_ > 1) {
+    InflateWindow(index);
+    auto itr = inflate_list_.find(index);
+    auto& job = *itr->second;
+    {
+      std::unique_lock lock(locker_);
+      done_event_.wait(lock, [&] { return job.done; });
+    }
+    // The area buffer is handed to the job, so the buffers are reused
+    std::swap(area_, job.data);
+    size = job.size;
+    free_list_.push_back(std::move(itr->second));
+    inflate_list_.erase(itr);
+  } else if (!Chunked(block) && Batched()) {
+    if (index >= batch_first_ + batch_size_) {
+      ReadBatch();
+    }
+    area_.resize(block->DataSize());
+    block->CopyDataToBuffer(*batch_list_[index - batch_first_], area_, size);
+  } else if (compressed) {
+    area_.resize(block->DataSize());
+    block->CopyDataToBuffer(file_, area_, size);
+  } else {
+    // The first chunk of an uncompressed block. Remaining chunks are read above.
+    area_.resize(std::min(block->DataSize() - skip, kChunkSize));
+    file_.pubseekpos(block->DataPosition() + static_cast<int64_t>(skip), std::ios_base::in);
+    const auto reads = file_.sgetn(reinterpret_cast<char*>(area_.data()),
+                                   static_cast<std::streamsize>(area_.size()));
+    size = reads > 0 ? static_cast<size_t>(reads) : 0;
+    chunk_offset_ = skip + size;
+    auto* begin = reinterpret_cast<char*>(area_.data());
+    setg(begin, begin, begin + size);
+    return true;
+  }
+  if (size != block->DataSize()) {
+    // Parsing the area would parse stale bytes of an earlier block
+    throw std::ios_base::failure("Failed to decode a data block");
+  }
+  // A decoded block starts at the skipped bytes
+  auto* begin = reinterpret_cast<char*>(area_.data());
+  setg(begin, begin + std::min(skip, size), begin + size);
+  return true;
+}
+
+void DataListBuffer::InflateWindow(size_t index) {
+  if (worker_list_.empty()) {
+    worker_list_.reserve(inflate_threads_);
+    for (size_t thread = 0; thread < inflate_threads_; ++thread) {
+      worker_list_.emplace_back(&DataListBuffer::InflateThread, this);
+    }
+  }
+
+  // The stored bytes are read by this thread, so the file isn't shared
+  // between the threads. The workers only inflate memory buffers.
+  std::vector<InflateJob*> load_list;
+  std::vector<ReadRequest> request_list;
+  for (size_t next = index; next < data_list_.size() && next < index + inflate_threads_; ++next) {
+    const auto* block = data_list_[next];
+    if (inflate_list_.contains(next) || dynamic_cast<const Dz4Block*>(block) == nullptr) {
+      continue;
+    }
+    std::unique_ptr<InflateJob> job;
+    if (free_list_.empty()) {
+      job = std::make_unique<InflateJob>();
+    } else {
+      job = std::move(free_list_.back());
+      free_list_.pop_back();
+    }
+    job->block = block;
+    job->size = 0;
+    job->done = false;
+    if (positional_ != nullptr) {
+      ReadRequest request;
+      request.offset = block->DataPosition();
+      request.size = block->StoredSize();
+      request.dest = job->stored.Allocate(request.offset, request.size);
+      request_list.push_back(request);
+    } else {
+      file_.pubseekpos(block->DataPosition(), std::ios_base::in);
+      job->stored.Load(file_, block->DataPosition(), block->StoredSize());
+    }
+    load_list.push_back(job.get());
+    inflate_list_.emplace(next, std::move(job));
+  }
+  if (!request_list.empty() && !positional_->ReadBatch(request_list)) {
+    throw std::ios_base::failure("Failed to read the data blocks");
+  }
+  if (load_list.empty()) {
+    return;
+  }
+  {
+    std::lock_guard lock(locker_);
+    job_queue_.insert(job_queue_.end(), load_list.cbegin(), load_list.cend());
+  }
+  job_event_.notify_all();
+}
+
+void DataListBuffer::InflateThread() {
+  for (;;) {
+    InflateJob* job = nullptr;
+    {
+      std::unique_lock lock(locker_);
+      job_event_.wait(lock, [&] { return stop_thread_ || !job_queue_.empty(); });
+      if (stop_thread_) {
+        return;
+      }
+      job = job_queue_.front();
+      job_queue_.pop_front();
+    }
+
+    // The decoded buffer keeps its memory, so only a larger block allocates
+    size_t size = 0;
+    try {
+      job->data.resize(job->block->DataSize());
+      job->block->CopyDataToBuffer(job->stored, job->data, size);
+    } catch (const std::exception&) {
+      size = 0; // Reported as a block that failed to decode
+    }
+    {
+      std::lock_guard lock(locker_);
+      job->size = size;
+      job->done = true;
+    }
+    done_event_.notify_one();
+  }
+}
+
+void DataListBuffer::ReadBatch() {
+  std::vector<ReadRequest> request_list;
+  batch_first_ = next_block_ - 1;
+  size_t bytes = 0;
+  for (size_t index = batch_first_; index < data_list_.size() &&
+       request_list.size() < kBatchBlocks && (request_list.empty() || bytes < kBatchBytes); ++index) {
+    const auto* block = data_list_[index];
+    if (Chunked(block)) {
+      break; // The batch ends at a large uncompressed block
+    }
+    if (batch_list_.size() <= request_list.size()) {
+      batch_list_.emplace_back(std::make_unique<BlockBuffer>());
+    }
+    ReadRequest request;
+    request.offset = block->DataPosition();
+    request.size = block->StoredSize();
+    request.dest = batch_list_[request_list.size()]->Allocate(request.offset, request.size);
+    bytes += request.size;
+    request_list.push_back(request);
+  }
+  batch_size_ = request_list.size();
+  if (!positional_->ReadBatch(request_list)) {
+    throw std::ios_base::failure("Failed to read the data blocks");
+  }
+}
+
+}  // namespace mdf::detail
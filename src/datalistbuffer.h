@@ -0,0 +1,151 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+#include "datalistblock.h"
+#include "datablock.h"
+#include "memorybuffer.h"
+
+namespace mdf::detail {
+
+class PositionalFile;
+
+/** \class DataListBuffer datalistbuffer.h "datalistbuffer.h"
+ * \brief Stream buffer over the decoded bytes of a list of data blocks.
+ *
+ * The data blocks (DT and DZ) are read in list order and presented as one
+ * continuous stream, so a record that spans two blocks is read as any other
+ * record. One decoded block at a time is held in memory. Uncompressed blocks are
+ * read in chunks. With the positional backend, the stored block bytes are
+ * read in batches. Uncompressed blocks larger than a chunk are still read in
+ * chunks, so a large DT block is never held in memory.
+ *
+ * With inflate threads, the DZ blocks are inflated in parallel. A window of
+ * DZ blocks ahead of the current block are inflated on worker threads while
+ * the records are parsed. The window is as many blocks as threads, which
+ * bounds the memory use. The blocks are still delivered in list order. The
+ * worker threads are started at the first DZ block and live as long as the
+ * buffer. The stored and decoded block buffers are reused between the blocks.
+ *
+ * A DZ block that fails to decode throws an ios_base::failure exception
+ * when it is read, so stale bytes are never parsed.
+ *
+ * The buffer is read forward only and doesn't support seeking. The stream
+ * may start at a data offset, see SkipTo(). The blocks before the offset
+ * are not read.
+ */
+class DataListBuffer : public std::streambuf {
+ public:
+  /** \brief Creates the buffer.
+   *
+   * @param block_list Data blocks. Data list blocks are traversed recursively.
+   * @param file File with the data blocks.
+   */
+  DataListBuffer(const DataListBlock::BlockList& block_list, std::streambuf& file);
+  ~DataListBuffer() override;
+
+  DataListBuffer(const DataListBuffer&) = delete;
+  DataListBuffer& operator=(const DataListBuffer&) = delete;
+
+  [[nodiscard]] size_t DataSize() const; ///< Total number of decoded bytes.
+
+  /** \brief Inflates the DZ blocks in parallel.
+   *
+   * @param nof_threads Max number of blocks inflated at the same time. Less
+   * than 2 inflates the blocks in the parsing thread.
+   */
+  void SetInflateThreads(size_t nof_threads);
+
+  /** \brief Starts the stream at an offset in the decoded bytes.
+   *
+   * The data block sizes are known from the block headers, so the blocks
+   * before the offset are neither read nor decoded. Must be called before the
+   * first read.
+   * @param offset Offset from the start of the first data block.
+   */
+  void SkipTo(uint64_t offset);
+
+  /** \brief Reads decoded bytes at an offset (random access).
+   *
+   * Used to probe single records. The last inflated DZ block is kept, so
+   * reads within the same block don't inflate it again. Uncompressed bytes
+   * are read directly from the file. The stream position isn't used. The read
+   * stops at a DZ block that fails to decode.
+   * @param offset Offset from the start of the first data block.
+   * @param dest Destination buffer.
+   * @param size Number of bytes to read.
+   * @return Number of bytes read.
+   */
+  size_t ReadAt(uint64_t offset, uint8_t* dest, size_t size);
+
+  /** \brief Returns the offset of each data block.
+   *
+   * The list has one more item than the number of data blocks. The last item
+   * is the total data size.
+   */
+  [[nodiscard]] const std::vector<uint64_t>& BlockOffsets();
+
+  /** \brief Returns the master value of the first record in each data block.
+   *
+   * The values are the time values of the data list blocks. The list is empty
+   * unless all data list blocks have time values.
+   */
+  [[nodiscard]] std::vector<int64_t> TimeValues() const;
+ protected:
+  int_type underflow() override;
+ private:
+  const DataListBlock::BlockList& block_list_;
+  std::vector<const DataBlock*> data_list_; ///< All data blocks in stream order.
+  std::streambuf& file_;
+  const PositionalFile* positional_ = nullptr; ///< Set if the blocks are read in batches.
+  size_t next_block_ = 0; ///< Index of the next block to decode.
+  size_t chunk_offset_ = 0; ///< Bytes read of the current uncompressed block.
+  size_t skip_bytes_ = 0; ///< Bytes to skip at the start of the next block.
+  std::vector<uint8_t> area_; ///< Decoded bytes. Used as get area.
+
+  std::vector<std::unique_ptr<BlockBuffer>> batch_list_; ///< Stored bytes of the blocks in a batch.
+  size_t batch_first_ = 0; ///< Index of the first block in the batch.
+  size_t batch_size_ = 0; ///< Number of blocks in the batch.
+
+  /// A DZ block that is inflated by a worker thread.
+  struct InflateJob {
+    const DataBlock* block = nullptr;
+    BlockBuffer stored; ///< Stored (compressed) bytes of the block.
+    std::vector<uint8_t> data; ///< Decoded bytes.
+    size_t size = 0; ///< Number of decoded bytes. 0 if the block failed to decode.
+    bool done = false; ///< Set by the worker when the block is inflated.
+  };
+
+  size_t inflate_threads_ = 0; ///< Max number of parallel inflates.
+  std::vector<std::thread> worker_list_; ///< Inflate threads.
+  bool stop_thread_ = false; ///< Stops the inflate threads.
+  std::mutex locker_; ///< Protects the job queue and the job states.
+  std::condition_variable job_event_; ///< Signals a queued job to the workers.
+  std::condition_variable done_event_; ///< Signals an inflated block to the parser.
+  std::deque<InflateJob*> job_queue_; ///< Jobs waiting for a worker.
+  std::map<size_t, std::unique_ptr<InflateJob>> inflate_list_; ///< Jobs in the window by block index.
+  std::vector<std::unique_ptr<InflateJob>> free_list_; ///< Delivered jobs. Their buffers are reused.
+
+  std::vector<uint64_t> offset_list_; ///< Data offset of each block.
+  size_t cache_index_ = 0; ///< Index of the cached block.
+  std::vector<uint8_t> cache_; ///< Last inflated block in ReadAt().
+
+  [[nodiscard]] bool Batched() const; ///< True if the blocks are read in batches.
+  [[nodiscard]] bool Chunked(const DataBlock* block) const; ///< True if the block is read in chunks.
+  bool NextArea(); ///< Fills the get area with the next decoded bytes.
+  void ReadBatch(); ///< Reads the stored bytes of the next batch of blocks.
+  void InflateWindow(size_t index); ///< Starts inflating the DZ blocks in the window.
+  void InflateThread(); ///< Worker thread that inflates the queued blocks.
+};
+
+}  // namespace mdf::detail
@@ -4,6 +4,8 @@
  */
 #include <algorithm>
 #include "dg3block.h"
+#include "recordbuffer.h"
+#include "recordidtable.h"
 namespace {
 constexpr size_t kIndexNext = 0;
 constexpr size_t kIndexCg = 1;
@@ -46,7 +48,7 @@ void Dg3Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Record ID size [bytes]", std::to_string(nof_record_id_));
 }
 
-size_t Dg3Block::Read(std::FILE *file) {
+size_t Dg3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadLinks3(file, 4);
   bytes += ReadNumber(file, nof_cg_blocks_);
@@ -169,62 +171,70 @@ IChannelGroup *Dg3Block::CreateChannelGroup() {
   return cg_list_.empty() ? nullptr : cg_list_.back().get();
 }
 
-void Dg3Block::ReadData(std::FILE *file) const {
-  if (file == nullptr) {
-    throw std::invalid_argument("File pointer is null");
+void Dg3Block::ReadData(std::streambuf& file) const {
+  ReadData(file, 0, std::numeric_limits<size_t>::max());
+}
+
+void Dg3Block::ReadData(std::streambuf& file, size_t first_sample, size_t nof_samples) const {
+  constexpr auto kMaxSample = std::numeric_limits<size_t>::max();
+  const auto last_sample = nof_samples < kMaxSample - first_sample ?
+      first_sample + nof_samples : kMaxSample;
+  ResetSample();
+
+  // A sorted group is read from the first sample
+  uint64_t offset = 0;
+  uint64_t data_size = DataSize();
+  const auto* cg3 = cg_list_.size() == 1 && nof_record_id_ == 0 ? cg_list_[0].get() : nullptr;
+  if (cg3 != nullptr && cg3->RecordSize() > 0 && (first_sample > 0 || last_sample < kMaxSample)) {
+    const auto first = std::min<uint64_t>(first_sample, cg3->NofSamples());
+    const auto last = std::min<uint64_t>(last_sample, cg3->NofSamples());
+    offset = std::min<uint64_t>(first * cg3->RecordSize(), data_size);
+    data_size = std::min((last - first) * cg3->RecordSize(), data_size - offset);
+    cg3->Sample(static_cast<size_t>(first));
   }
-  std::FILE* data_file = nullptr;
-  size_t data_size = DataSize();
-  SetFilePosition(file, Link(kIndexData));
-  data_file = file;
+  SetFilePosition(file, Link(kIndexData) + static_cast<int64_t>(offset));
 
-  auto pos = GetFilePosition(data_file);
   // Read through all record
-  ParseDataRecords(data_file, data_size);
+  ParseDataRecords(file, data_size, first_sample, last_sample);
 }
 
-void Dg3Block::ParseDataRecords(std::FILE *file, size_t nof_data_bytes) const {
-  if (file == nullptr || nof_data_bytes == 0) {
+void Dg3Block::ParseDataRecords(std::streambuf& file, uint64_t nof_data_bytes,
+                                size_t first_sample, size_t last_sample) const {
+  if (nof_data_bytes == 0) {
     return;
   }
-  ResetSample();
 
-  for (size_t count = 0; count < nof_data_bytes; /* No ++count here*/) {
-    // 1. Read Record ID
-    uint8_t record_id = 0;
-    if (nof_record_id_ == 1 || nof_record_id_ == 2) {
-      count += ReadNumber(file,record_id);
-    }
-    const auto* cg3 = FindCgRecordId(record_id);
-    if (cg3 == nullptr) {
-      break;
+  RecordIdTable<Cg3Block> cg_table;
+  for (const auto& cg : cg_list_) {
+    if (cg) {
+      cg_table.Add(cg->RecordId(), cg.get(), cg->RecordSize(),
+                   IsRecordIdNeeded(cg->RecordId()));
     }
+  }
 
-    const auto read = cg3->ReadDataRecord(file, *this);
-    if (read == 0) {
+  RecordBuffer buffer(file, nof_data_bytes);
+  std::vector<uint8_t> record; // Reused for all records
+  // The record ID is stored before the record and optionally after it
+  const size_t id_size = nof_record_id_ == 1 || nof_record_id_ == 2 ? 1 : 0;
+  const size_t trailer_size = nof_record_id_ == 2 ? 1 : 0;
+  while (buffer.Fill(std::max<size_t>(id_size, 1))) {
+    const uint8_t record_id = id_size > 0 ? *buffer.Current() : 0;
+    const auto* entry = cg_table.Find(record_id);
+    if (entry == nullptr || entry->record_size == 0) {
       break;
     }
-    count += read;
-    if (nof_record_id_ == 2) {
-      count += ReadNumber(file,record_id);
-    }
-  }
-}
-
-const Cg3Block *Dg3Block::FindCgRecordId(const uint64_t record_id) const {
-  if (cg_list_.size() == 1) {
-    return cg_list_[0].get();
-  }
-
-  for (const auto& cg : cg_list_) {
-    if (!cg) {
-      continue;
+    const size_t size = id_size + entry->record_size + trailer_size;
+    if (!buffer.Fill(size)) {
+      break;
     }
-    if (cg->RecordId() == record_id) {
-      return cg.get();
+    const auto sample = entry->group->Sample();
+    if (entry->needed && sample >= first_sample && sample < last_sample) {
+      entry->group->ReadDataRecord(buffer.Current() + id_size, record, *this);
+    } else if (sample < entry->group->NofSamples()) {
+      entry->group->IncrementSample(); // Nobody observes the record
     }
+    buffer.Skip(size);
   }
-  return nullptr;
 }
 
 
@@ -3,6 +3,7 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <limits>
 #include <string>
 #include <memory>
 #include <vector>
@@ -32,10 +33,20 @@ class Dg3Block : public DataListBlock, public IDataGroup {
   }
   void GetBlockProperty(BlockPropertyList& dest) const override;
   [[nodiscard]] const IBlock* Find(fpos_t index) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
 
-  void ReadData(std::FILE* file) const;
+  void ReadData(std::streambuf& file) const;
+  /** \brief Reads a range of samples and notifies the sample observers.
+   *
+   * A data group with one channel group and no record IDs is read from the
+   * first sample. Other data groups are parsed from the start, but only the
+   * samples in the range are notified.
+   * @param file File to read from.
+   * @param first_sample Index of the first sample.
+   * @param nof_samples Max number of samples.
+   */
+  void ReadData(std::streambuf& file, size_t first_sample, size_t nof_samples) const;
  private:
 
   uint16_t nof_cg_blocks_ = 0;
@@ -43,8 +54,8 @@ class Dg3Block : public DataListBlock, public IDataGroup {
 
   std::unique_ptr<Tr3Block> tr_block_;
   Cg3List cg_list_;
-  void ParseDataRecords(std::FILE* file, size_t nof_data_bytes) const;
-  const Cg3Block* FindCgRecordId(const uint64_t record_id) const;
+  void ParseDataRecords(std::streambuf& file, uint64_t nof_data_bytes,
+                        size_t first_sample, size_t last_sample) const;
 };
 
 }
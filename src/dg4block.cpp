@@ -2,12 +2,16 @@
  * Copyright 2021 Ingemar Hedvall
  * SPDX-License-Identifier: MIT
  */
+#include <algorithm>
+#include <bit>
 #include <stdexcept>
 #include "dg4block.h"
 #include "dt4block.h"
 #include "dz4block.h"
 #include "dl4block.h"
 #include "hl4block.h"
+#include "datalistbuffer.h"
+#include "recordidtable.h"
 
 namespace {
 constexpr size_t kIndexCg = 1;
@@ -15,24 +19,31 @@ constexpr size_t kIndexData = 2;
 constexpr size_t kIndexMd = 3;
 constexpr size_t kIndexNext = 0;
 
-///< Helper function that recursively copies all data bytes to a
-/// destination file.
-size_t CopyDataToFile(const mdf::detail::DataListBlock::BlockList& block_list,  //NOLINT
-                      std::FILE* from_file, std::FILE* to_file) {
-  size_t count = 0;
-  for (const auto& block : block_list) {
-    if (!block) {
-      continue;
-    }
-    const auto* db = dynamic_cast< const mdf::detail::DataBlock* > (block.get());
-    const auto* dl = dynamic_cast< const mdf::detail::DataListBlock* > (block.get());
-    if (db != nullptr) {
-      count += db->CopyDataToFile(from_file, to_file);
-    } else if (dl != nullptr) {
-      count += CopyDataToFile(dl->DataBlockList(),from_file, to_file);
-    }
+/// Converts a raw master value to its engineering value.
+double MasterValue(const mdf::IChannel& master, double raw) {
+  const auto* cc = master.ChannelConversion();
+  double value = raw;
+  if (cc != nullptr && !cc->Convert(raw, value)) {
+    value = raw;
   }
-  return count;
+  return value;
+}
+
+/// Converts a DL/LD time value. The value holds the bits of a double for float masters.
+double TimeValue(const mdf::IChannel& master, int64_t time) {
+  switch (master.DataType()) {
+    case mdf::ChannelDataType::FloatLe:
+    case mdf::ChannelDataType::FloatBe:
+      return MasterValue(master, std::bit_cast<double>(time));
+
+    case mdf::ChannelDataType::UnsignedIntegerLe:
+    case mdf::ChannelDataType::UnsignedIntegerBe:
+      return MasterValue(master, static_cast<double>(static_cast<uint64_t>(time)));
+
+    default:
+      break;
+  }
+  return MasterValue(master, static_cast<double>(time));
 }
 
 }
@@ -79,11 +90,12 @@ void Dg4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Dg4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, rec_id_size_);
+size_t Dg4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, rec_id_size_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 7);
+  bytes += ReadByte(data, reserved, 7);
 
   ReadMdComment(file, kIndexMd);
   ReadBlockList(file, kIndexData);
@@ -112,14 +124,16 @@ size_t Dg4Block::DataSize() const {
   return DataListBlock::DataSize();
 }
 
-void Dg4Block::ReadCgList(std::FILE* file) {
+void Dg4Block::ReadCgList(std::streambuf& file) {
   ReadLink4List(file, cg_list_, kIndexCg);
 }
 
-void Dg4Block::ReadData(std::FILE *file) const {
-  if (file == nullptr) {
-    throw std::invalid_argument("File pointer is null");
-  }
+void Dg4Block::ReadData(std::streambuf& file, size_t inflate_threads) const {
+  ReadData(file, 0, std::numeric_limits<size_t>::max(), inflate_threads);
+}
+
+void Dg4Block::ReadData(std::streambuf& file, size_t first_sample, size_t nof_samples,
+                        size_t inflate_threads) const {
   const auto& block_list = DataBlockList();
   if (block_list.empty()) {
     return;
@@ -127,7 +141,7 @@ void Dg4Block::ReadData(std::FILE *file) const {
   // First scan through all CN blocks and read in any VLSD data related data bytes into memory.
 
   for (const auto& cg : cg_list_) {
-    if (!cg) {
+    if (!cg || !IsRecordIdNeeded(cg->RecordId())) {
       continue;
     }
     for (const auto& cn : cg->Cn4()) {
@@ -138,34 +152,43 @@ void Dg4Block::ReadData(std::FILE *file) const {
     }
   }
 
+  constexpr auto kMaxSample = std::numeric_limits<size_t>::max();
+  const auto last_sample = nof_samples < kMaxSample - first_sample ?
+      first_sample + nof_samples : kMaxSample;
+  ResetSample();
 
-  // Convert everything to a samples in a file single DT block can be read directly but remaining
-  // block types are streamed to a temporary file. The main reason is that linked data blocks not
-  // is aligned to a record or even worse a channel value bytes. Converting everything to a simple
-  // DT block solves that problem.
+  // A sorted group with fixed length records is read from the first sample
+  uint64_t offset = 0;
+  auto nof_bytes = std::numeric_limits<uint64_t>::max();
+  const auto* cg = cg_list_.size() == 1 && rec_id_size_ == 0 ? cg_list_[0].get() : nullptr;
+  const uint64_t record_size = cg != nullptr ? cg->FixedRecordSize() : 0;
+  if (record_size > 0 && (first_sample > 0 || last_sample < kMaxSample)) {
+    const auto first = std::min<uint64_t>(first_sample, cg->NofSamples());
+    const auto last = std::min<uint64_t>(last_sample, cg->NofSamples());
+    offset = first * record_size;
+    nof_bytes = (last - first) * record_size;
+    cg->Sample(static_cast<size_t>(first));
+  }
 
-  bool close_data_file = false;
-  std::FILE* data_file = nullptr;
-  size_t data_size = 0;
+  // A single DT block is read directly from the file. Other block lists are
+  // streamed through a buffer that decodes one data block at a time. The
+  // linked data blocks aren't aligned to records, so a record may span two
+  // blocks. The buffer hides the block boundaries from the record parsing.
   if ( block_list.size() == 1 && block_list[0] && block_list[0]->BlockType() == "DT") { // If DT read from file directly
     const auto* dt = dynamic_cast<const Dt4Block*> (block_list[0].get());
     if (dt != nullptr) {
-      SetFilePosition(file, dt->DataPosition());
-      data_file = file;
-      data_size = dt->DataSize();
+      const uint64_t data_size = dt->DataSize();
+      offset = std::min(offset, data_size);
+      SetFilePosition(file, dt->DataPosition() + static_cast<int64_t>(offset));
+      ParseDataRecords(file, std::min(nof_bytes, data_size - offset), first_sample, last_sample);
     }
   } else {
-    close_data_file = true;
-    data_file = std::tmpfile();
-    data_size = CopyDataToFile(block_list, file, data_file);
-    std::rewind(data_file); //SetFilePosition(data_file,0);
-  }
-
-  auto pos = GetFilePosition(data_file);
-  // Read through all record
-  ParseDataRecords(data_file, data_size);
-  if (data_file != nullptr && close_data_file) {
-    fclose(data_file);
+    DataListBuffer data_file(block_list, file);
+    data_file.SetInflateThreads(inflate_threads);
+    const uint64_t data_size = data_file.DataSize();
+    offset = std::min(offset, data_size);
+    data_file.SkipTo(offset);
+    ParseDataRecords(data_file, std::min(nof_bytes, data_size - offset), first_sample, last_sample);
   }
 
   for (const auto& cg : cg_list_) {
@@ -181,82 +204,237 @@ void Dg4Block::ReadData(std::FILE *file) const {
   }
 }
 
-void Dg4Block::ParseDataRecords(std::FILE *file, size_t nof_data_bytes) const {
-  if (file == nullptr || nof_data_bytes == 0) {
-    return;
+bool Dg4Block::FindSampleRange(std::streambuf& file, double start_time, double end_time,
+                               size_t& first_sample, size_t& nof_samples) const {
+  first_sample = 0;
+  nof_samples = 0;
+  const auto* cg = cg_list_.size() == 1 && rec_id_size_ == 0 ? cg_list_[0].get() : nullptr;
+  const size_t record_size = cg != nullptr ? cg->FixedRecordSize() : 0;
+  if (record_size == 0) {
+    return false;
+  }
+  const IChannel* master = nullptr;
+  for (const auto& cn : cg->Cn4()) {
+    if (cn && (cn->Type() == ChannelType::Master || cn->Type() == ChannelType::VirtualMaster)) {
+      master = cn.get();
+      break;
+    }
+  }
+  if (master == nullptr) {
+    return false;
+  }
+  const auto& block_list = DataBlockList();
+  const auto nof_records = static_cast<size_t>(cg->NofSamples());
+  if (block_list.empty() || nof_records == 0) {
+    return true;
   }
-  ResetSample();
 
-  for (size_t count = 0; count < nof_data_bytes; /* No ++count here*/) {
-    // 1. Read Record ID
-    uint64_t record_id = 0;
-    count += ReadRecordId(file, record_id);
+  DataListBuffer data_file(block_list, file);
+  std::vector<uint8_t> record(record_size);
+  const bool virtual_master = master->Type() == ChannelType::VirtualMaster;
+  auto sample_time = [&] (size_t sample) {
+    if (virtual_master) {
+      return MasterValue(*master, static_cast<double>(sample));
+    }
+    if (data_file.ReadAt(static_cast<uint64_t>(sample) * record_size,
+                         record.data(), record_size) != record_size) {
+      throw std::runtime_error("Failed to read a master record");
+    }
+    double raw = 0;
+    master->GetChannelValue(record, raw);
+    return MasterValue(*master, raw);
+  };
+
+  // The time value of a data block belongs to the first record that starts in the block
+  std::vector<std::pair<size_t, double>> hint_list;
+  const auto time_list = virtual_master ? std::vector<int64_t>() : data_file.TimeValues();
+  const auto& offset_list = data_file.BlockOffsets();
+  for (size_t block = 0; block < time_list.size(); ++block) {
+    const auto sample = static_cast<size_t>(
+        (offset_list[block] + record_size - 1) / record_size);
+    if (sample < nof_records) {
+      hint_list.emplace_back(sample, TimeValue(*master, time_list[block]));
+    }
+  }
 
-    const auto* cg = FindCgRecordId(record_id);
-    if (cg == nullptr) {
-      break;
+  // Returns the first sample where the (increasing) predicate is true
+  auto search = [&] (const auto& predicate) {
+    size_t low = 0;
+    size_t high = nof_records;
+    const auto itr = std::ranges::partition_point(hint_list, [&] (const auto& hint) {
+      return !predicate(hint.second);
+    });
+    // The hints are verified by reading the record, so a bad hint only costs a read
+    if (itr != hint_list.cend() && predicate(sample_time(itr->first))) {
+      high = itr->first;
     }
-    const auto read = cg->ReadDataRecord(file, *this);
-    if (read == 0) {
-      break;
+    if (itr != hint_list.cbegin() && !predicate(sample_time(std::prev(itr)->first))) {
+      low = std::min(std::prev(itr)->first + 1, high);
     }
+    while (low < high) {
+      const auto middle = low + (high - low) / 2;
+      if (predicate(sample_time(middle))) {
+        high = middle;
+      } else {
+        low = middle + 1;
+      }
+    }
+    return low;
+  };
+  const auto first = search([&] (double time) { return time >= start_time; });
+  const auto last = search([&] (double time) { return time > end_time; });
+  first_sample = first;
+  nof_samples = last > first ? last - first : 0;
+  return true;
+}
 
-    count += read;
+size_t Dg4Block::ReadNewData(std::streambuf& file, bool to_end, int64_t last_position,
+                             uint64_t& consumed) const {
+  // The writer may add the DT block and update its length after the file was
+  // opened, so the data link and the DT header are re-read.
+  const auto dt_position = ReadLink4(file, kIndexData);
+  if (dt_position <= 0) {
+    return 0;
   }
-}
+  uint64_t block_length = 0;
+  uint64_t nof_links = 0;
+  const auto block_type = ReadBlockHeader4(file, dt_position, block_length, nof_links);
+  if (block_type != "##DT") {
+    throw std::runtime_error("Follow mode requires a single DT block");
+  }
+  const auto data_position = dt_position + static_cast<int64_t>(24 + (nof_links * 8));
 
-size_t Dg4Block::ReadRecordId(std::FILE *file, uint64_t &record_id) const {
-  record_id = 0;
-  if (file == 0) {
+  // Only the last DT block in the file may be longer than its header says.
+  int64_t data_end = dt_position + static_cast<int64_t>(block_length);
+  if (to_end && dt_position >= last_position && IsLastBlock(dt_position)) {
+    data_end = static_cast<int64_t>(file.pubseekoff(0, std::ios_base::end, std::ios_base::in));
+  }
+  auto position = data_position + static_cast<int64_t>(consumed);
+  if (position >= data_end) {
     return 0;
   }
-  size_t count = 0;
-  switch (rec_id_size_) {
-    case 1: {
-      uint8_t id = 0;
-      count += ReadNumber(file, id);
-      record_id = id;
-      break;
-    }
 
-    case 2: {
-      uint16_t id = 0;
-      count += ReadNumber(file, id);
-      record_id = id;
-      break;
+  if (consumed == 0) {
+    ResetSample();
+  }
+  // The VLSD data is kept between the calls, so only new SD bytes are read.
+  for (const auto& cg : cg_list_) {
+    if (!cg || !IsRecordIdNeeded(cg->RecordId())) {
+      continue;
     }
-
-    case 4: {
-      uint32_t id = 0;
-      count += ReadNumber(file, id);
-      record_id = id;
-      break;
+    for (const auto& cn : cg->Cn4()) {
+      if (!cn || cn->Type() != ChannelType::VariableLength) {
+        continue;
+      }
+      if (consumed == 0) {
+        cn->ClearData();
+      }
+      cn->ReadNewData(file);
     }
+  }
 
-    case 8: {
-      uint64_t id = 0;
-      count += ReadNumber(file, id);
-      record_id = id;
-      break;
+  SetFilePosition(file, position);
+  RecordBuffer buffer(file, static_cast<uint64_t>(data_end - position));
+  const auto nof_records = ParseRecords(buffer, true);
+  position += static_cast<int64_t>(buffer.Consumed());
+  consumed = static_cast<uint64_t>(position - data_position);
+  return nof_records;
+}
+
+int64_t Dg4Block::LastDataPosition(std::streambuf& file) const {
+  auto last_position = ReadLink4(file, kIndexData);
+  for (const auto& cg : cg_list_) {
+    if (!cg) {
+      continue;
+    }
+    for (const auto& cn : cg->Cn4()) {
+      if (cn && cn->Type() == ChannelType::VariableLength) {
+        last_position = std::max(last_position, cn->ReadDataLink(file));
+      }
     }
-    default: break;
   }
-  return count;
+  return last_position;
 }
 
-const Cg4Block *Dg4Block::FindCgRecordId(const uint64_t record_id) const {
-  if (cg_list_.size() == 1) {
-    return cg_list_[0].get();
+void Dg4Block::ParseDataRecords(std::streambuf& file, uint64_t nof_data_bytes,
+                                size_t first_sample, size_t last_sample) const {
+  if (nof_data_bytes == 0) {
+    return;
   }
+  RecordBuffer buffer(file, nof_data_bytes);
+  ParseRecords(buffer, false, first_sample, last_sample);
+}
+
+size_t Dg4Block::ParseRecords(RecordBuffer& buffer, bool follow, size_t first_sample,
+                              size_t last_sample) const {
+  RecordIdTable<Cg4Block> cg_table;
+  size_t nof_groups = 0;
   for (const auto& cg : cg_list_) {
     if (!cg) {
       continue;
     }
-    if (cg->RecordId() == record_id) {
-      return cg.get();
+    const bool needed = IsRecordIdNeeded(cg->RecordId());
+    cg_table.Add(cg->RecordId(), cg.get(), cg->FixedRecordSize(), needed);
+    // Only needed groups with samples left in the range keep the parsing going
+    if (needed && cg->Sample() < std::min<uint64_t>(last_sample, cg->NofSamples())) {
+      ++nof_groups;
+    }
+  }
+
+  const bool ranged = last_sample < std::numeric_limits<size_t>::max();
+  if (ranged && nof_groups == 0) {
+    return 0; // No group has samples in the range
+  }
+  const size_t id_size = rec_id_size_;
+  std::vector<uint8_t> record; // Reused for all records
+  size_t nof_records = 0;
+  size_t nof_done = 0; // Number of groups that have passed the sample range
+  for (;;) {
+    // Also try to get the VLSD length field. This fails at the end of the data.
+    if (!buffer.Fill(id_size + sizeof(uint32_t)) && buffer.Available() <= id_size) {
+      break;
+    }
+    const auto* entry = cg_table.Find(ReadRecordId(buffer.Current()));
+    if (entry == nullptr) {
+      break;
+    }
+    auto* cg = entry->group;
+    const auto record_size = entry->record_size > 0 ? entry->record_size :
+        cg->NextRecordSize(buffer.Current() + id_size, buffer.Available() - id_size);
+    if (record_size == 0 || !buffer.Fill(id_size + record_size)) {
+      break; // The record isn't complete
+    }
+    if (follow && cg->Sample() >= cg->NofSamples()) {
+      // The cycle counter in the file isn't updated while writing
+      cg->NofSamples(cg->Sample() + 1);
+    }
+    const auto sample = cg->Sample();
+    if (entry->needed && sample >= first_sample && sample < last_sample) {
+      cg->ReadDataRecord(buffer.Current() + id_size, record, *this);
+    } else if (sample < cg->NofSamples()) {
+      cg->IncrementSample(); // Nobody observes the record, so it is skipped
+    }
+    buffer.Skip(id_size + record_size);
+    ++nof_records;
+
+    if (ranged && entry->needed && cg->Sample() != sample &&
+        cg->Sample() == std::min<uint64_t>(last_sample, cg->NofSamples()) &&
+        ++nof_done >= nof_groups) {
+      break; // All groups have passed the sample range
     }
   }
-  return nullptr;
+  return nof_records;
+}
+
+uint64_t Dg4Block::ReadRecordId(const uint8_t* data) const {
+  switch (rec_id_size_) {
+    case 1: return *data;
+    case 2: return boost::endian::load_little_u16(data);
+    case 4: return boost::endian::load_little_u32(data);
+    case 8: return boost::endian::load_little_u64(data);
+    default: break;
+  }
+  return 0;
 }
 
 std::vector<IChannelGroup *> Dg4Block::ChannelGroups() const {
@@ -299,11 +477,11 @@ int64_t Dg4Block::Index() const {
 
 IMetaData *Dg4Block::MetaData() {
   CreateMd4Block();
-  return dynamic_cast<IMetaData *>(md_comment_.get());
+  return dynamic_cast<IMetaData *>(MdComment());
 }
 
 const IMetaData *Dg4Block::MetaData() const {
-  return !md_comment_ ? nullptr : dynamic_cast<IMetaData *>(md_comment_.get());
+  return !md_comment_ ? nullptr : dynamic_cast<const IMetaData *>(md_comment_.get());
 }
 
 void Dg4Block::Description(const std::string &desc) {
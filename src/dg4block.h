@@ -3,12 +3,14 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <limits>
 #include <string>
 #include <memory>
 #include <vector>
 #include "mdf/idatagroup.h"
 #include "datalistblock.h"
 #include "cg4block.h"
+#include "recordbuffer.h"
 
 
 namespace mdf::detail {
@@ -33,10 +35,77 @@ class Dg4Block : public DataListBlock, public IDataGroup {
   void GetBlockProperty(BlockPropertyList& dest) const override;
   const IBlock* Find(fpos_t index) const override;
 
-  size_t Read(std::FILE *file) override;
-  void ReadCgList(std::FILE* file);
-
-  void ReadData(std::FILE* file) const;
+  size_t Read(std::streambuf& file) override;
+  void ReadCgList(std::streambuf& file);
+
+  /** \brief Reads the data records and notifies the sample observers.
+   *
+   * @param file File to read from.
+   * @param inflate_threads Max number of DZ blocks inflated in parallel.
+   */
+  void ReadData(std::streambuf& file, size_t inflate_threads = 0) const;
+
+  /** \brief Reads a range of samples and notifies the sample observers.
+   *
+   * Only the samples from the first sample, and at most the number of samples
+   * per channel group, are notified. A sorted data group (one channel group)
+   * with fixed length records starts reading at the first sample, as the
+   * record offset is the sample index times the record size. The data blocks
+   * before the offset are not read. Other data groups are parsed from the
+   * start, and the parsing stops when all channel groups have passed the range.
+   * @param file File to read from.
+   * @param first_sample Index of the first sample.
+   * @param nof_samples Max number of samples.
+   * @param inflate_threads Max number of DZ blocks inflated in parallel.
+   */
+  void ReadData(std::streambuf& file, size_t first_sample, size_t nof_samples,
+                size_t inflate_threads = 0) const;
+
+  /** \brief Reads the records that were appended since the last call.
+   *
+   * Follow mode for a file that is still being written. Only complete records
+   * beyond the consumed bytes are parsed, so the cost of a call depends on the
+   * new data only. The channel group sample counters grow with the new
+   * records. The data and SD links are re-read from the file, so blocks added
+   * after the file was opened are found. The VLSD data is kept between the
+   * calls. Only a single DT data block and single SD blocks are supported.
+   * @param file File to read from.
+   * @param to_end True if the last DT block ends at the end of the file. This
+   * is the case for an unfinished file where the last DT length isn't updated.
+   * The DT length is used if another block is stored after the DT block.
+   * @param last_position Highest data block position of all data groups in
+   * the file. See LastDataPosition().
+   * @param consumed Number of data bytes read by earlier calls. Updated by the call.
+   * @return Number of new records.
+   */
+  size_t ReadNewData(std::streambuf& file, bool to_end, int64_t last_position,
+                     uint64_t& consumed) const;
+
+  /** \brief Returns the highest file position of the DT and SD blocks.
+   *
+   * Follow mode. The links are read from the file, so data blocks added
+   * after the file was opened are found.
+   * @param file File to read from.
+   * @return File position of the last data block or 0 if no data.
+   */
+  [[nodiscard]] int64_t LastDataPosition(std::streambuf& file) const;
+
+  /** \brief Finds the samples within a time range.
+   *
+   * The master channel values are binary searched, so only a few records are
+   * read. The time values of the DL/LD blocks, if stored, narrow the search to
+   * a few data blocks before any record is read. Only a sorted data group
+   * (one channel group) with fixed length records and a master channel is
+   * supported. The master values must be increasing.
+   * @param file File to read from.
+   * @param start_time First master value (engineering value).
+   * @param end_time Last master value (engineering value).
+   * @param first_sample First sample with a master value at or after the start.
+   * @param nof_samples Number of samples up to and including the end.
+   * @return False if the data group isn't supported.
+   */
+  bool FindSampleRange(std::streambuf& file, double start_time, double end_time,
+                       size_t& first_sample, size_t& nof_samples) const;
   IMetaData *MetaData() override;
   const IMetaData *MetaData() const override;
   void RecordIdSize(uint8_t id_size) override;
@@ -48,9 +117,12 @@ class Dg4Block : public DataListBlock, public IDataGroup {
   /* 7 byte reserved */
   Cg4List cg_list_;
 
-  void ParseDataRecords(std::FILE* file, size_t nof_data_bytes) const;
-  size_t ReadRecordId(std::FILE* file, uint64_t& record_id) const;
-  const Cg4Block* FindCgRecordId(const uint64_t record_id) const;
+  void ParseDataRecords(std::streambuf& file, uint64_t nof_data_bytes,
+                        size_t first_sample, size_t last_sample) const;
+  /// Parses the complete records in the buffer. Notifies the samples from the first to the last sample.
+  size_t ParseRecords(RecordBuffer& buffer, bool follow, size_t first_sample = 0,
+                      size_t last_sample = std::numeric_limits<size_t>::max()) const;
+  [[nodiscard]] uint64_t ReadRecordId(const uint8_t* data) const;
 
 };
 
@@ -11,9 +11,12 @@ constexpr size_t kIndexData = 1;
 
 std::string MakeFlagString(uint8_t flag) {
   std::ostringstream s;
-  if (flag & 0x01) {
+  if (flag & mdf::detail::Dl4Flags::EqualLength) {
     s << "Equal";
   }
+  if (flag & mdf::detail::Dl4Flags::TimeValues) {
+    s << (s.str().empty() ? "Time" : ",Time");
+  }
   return s.str();
 }
 }
@@ -39,21 +42,29 @@ void Dl4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Dl4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, flags_);
+size_t Dl4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, flags_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 3);
-  bytes += ReadNumber(file, nof_blocks_);
+  bytes += ReadByte(data, reserved, 3);
+  bytes += ReadNumber(data, nof_blocks_);
   if (flags_ & Dl4Flags::EqualLength) {
-    bytes += ReadNumber(file, equal_length_);
+    bytes += ReadNumber(data, equal_length_);
   } else {
     for (uint32_t ii = 0; ii < nof_blocks_; ++ii) {
       uint64_t offset = 0;
-      bytes += ReadNumber(file, offset);
+      bytes += ReadNumber(data, offset);
       offset_list_.push_back(offset);
     }
   }
+  if (flags_ & Dl4Flags::TimeValues) {
+    for (uint32_t ii = 0; ii < nof_blocks_; ++ii) {
+      int64_t value = 0;
+      bytes += ReadNumber(data, value);
+      time_values_.push_back(value);
+    }
+  }
   ReadLinkList(file, kIndexData, nof_blocks_);
   return bytes;
 }
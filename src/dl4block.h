@@ -8,12 +8,13 @@
 namespace mdf::detail {
 namespace Dl4Flags {
 constexpr uint8_t EqualLength = 0x01;
+constexpr uint8_t TimeValues = 0x02;
 }
 
 class Dl4Block : public DataListBlock {
  public:
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
  private:
   uint8_t flags_ = 0;
   /* 3 byte reserved */
@@ -17,7 +17,7 @@ void Dt3Block::Init(const IBlock &id_block) {
   IBlock::Init(id_block);
 }
 
-size_t Dt3Block::Read(std::FILE *file) {
+size_t Dt3Block::Read(std::streambuf& file) {
   block_type_ = "DT";
   file_position_ =  GetFilePosition(file);
   data_position_ = file_position_;
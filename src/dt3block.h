@@ -14,7 +14,7 @@ class Dt3Block : public DataBlock {
  public:
   void Init(const IBlock &id_block) override;
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
   size_t DataSize() const override;
  private:
@@ -12,7 +12,7 @@ void Dt4Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Data Size [byte]", std::to_string(DataSize()));
 }
 
-size_t Dt4Block::Read(std::FILE *file) {
+size_t Dt4Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader4(file);
   data_position_ = GetFilePosition(file);
   return bytes;
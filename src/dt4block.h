@@ -9,7 +9,7 @@ namespace mdf::detail {
 class Dt4Block : public DataBlock {
  public:
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   [[nodiscard]] size_t DataSize() const override;
 };
 
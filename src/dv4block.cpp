@@ -13,7 +13,7 @@ void Dv4Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Data Size [byte]", std::to_string(DataSize()));
 }
 
-size_t Dv4Block::Read(std::FILE *file) {
+size_t Dv4Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader4(file);
   data_position_ = GetFilePosition(file);
   return bytes;
@@ -11,7 +11,7 @@ namespace mdf::detail {
 class Dv4Block : public DataBlock {
  public:
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   [[nodiscard]] size_t DataSize() const override;
 };
 
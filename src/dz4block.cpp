@@ -6,6 +6,7 @@
 #include <string>
 #include <mdf/zlibutil.h>
 #include "dz4block.h"
+#include "memorybuffer.h"
 
 namespace {
 
@@ -18,6 +19,25 @@ std::string MakeZipTypeString(uint8_t type) {
   }
   return "Unknown";
 }
+
+/* Scratch buffers that are reused by all DZ blocks decoded in a thread.
+ * The blocks are typically of the same size, so the buffers are only
+ * allocated once.
+ */
+mdf::ByteArray& CompressedScratch() {
+  thread_local mdf::ByteArray scratch;
+  return scratch;
+}
+
+mdf::ByteArray& InflatedScratch() {
+  thread_local mdf::ByteArray scratch;
+  return scratch;
+}
+
+mdf::ByteArray& DecodedScratch() {
+  thread_local mdf::ByteArray scratch;
+  return scratch;
+}
 }
 
 namespace mdf::detail {
@@ -32,7 +52,7 @@ void Dz4Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Data Size  [byte]", std::to_string(data_length_));
 }
 
-size_t Dz4Block::Read(std::FILE *file) {
+size_t Dz4Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader4(file);
   bytes += ReadStr(file, orig_block_type_, 2);
   bytes += ReadNumber(file, type_);
@@ -45,76 +65,74 @@ size_t Dz4Block::Read(std::FILE *file) {
   return bytes;
 }
 
-size_t Dz4Block::CopyDataToFile(std::FILE *from_file, std::FILE *to_file) const {
+size_t Dz4Block::CopyDataToFile(std::streambuf& from_file, std::streambuf& to_file) const {
   if (data_position_ == 0 || orig_data_length_ == 0 || data_length_ == 0) {
     return 0;
   }
-  SetFilePosition(from_file, data_position_);
-
-
-  size_t count = 0;
-  switch (static_cast<Dz4ZipType>(type_)) {
-    case Dz4ZipType::Deflate: {
-      const bool inflate = Inflate(from_file, to_file, data_length_);
-      count = inflate ? orig_data_length_ : 0;
-      break;
-    }
-
-    case Dz4ZipType::TransposeAndDeflate: {
-        ByteArray temp(data_length_, 0);
-        fread(temp.data(),1, temp.size(), from_file);
-        ByteArray out(orig_data_length_, 0);
-        const bool inflate = Inflate(temp, out);
-        InvTranspose(out, parameter_);
-        fwrite(out.data(),1, out.size(), to_file);
-        count = inflate ? orig_data_length_ : 0;
-        break;
-    }
-
-    default: break;
+  auto& decoded = DecodedScratch();
+  decoded.resize(orig_data_length_);
+  if (!Decode(from_file, decoded.data())) {
+    return 0;
   }
-  return count;
+  to_file.sputn(reinterpret_cast<const char*>(decoded.data()),
+                static_cast<std::streamsize>(decoded.size()));
+  return orig_data_length_;
 }
 
-size_t Dz4Block::CopyDataToBuffer(std::FILE *from_file, std::vector<uint8_t> &buffer, size_t& buffer_index) const {
+size_t Dz4Block::CopyDataToBuffer(std::streambuf& from_file, std::vector<uint8_t> &buffer, size_t& buffer_index) const {
   if (data_position_ == 0 || orig_data_length_ == 0 || data_length_ == 0) {
     return 0;
   }
+  if (buffer.size() < buffer_index + orig_data_length_) {
+    buffer.resize(buffer_index + orig_data_length_, 0);
+  }
+  // Inflates directly into the destination. Nothing is copied if it fails.
+  if (!Decode(from_file, buffer.data() + buffer_index)) {
+    return 0;
+  }
+  buffer_index += orig_data_length_;
+  return orig_data_length_;
+}
 
+bool Dz4Block::Decode(std::streambuf& from_file, uint8_t* dest) const {
   SetFilePosition(from_file, data_position_);
 
-  size_t count = 0;
-  switch (static_cast<Dz4ZipType>(type_)) {
-    case Dz4ZipType::Deflate: {
-      ByteArray temp(data_length_, 0);
-      fread(temp.data(),1, temp.size(), from_file);
-
-      ByteArray out(orig_data_length_, 0);
-      Inflate(temp,out);
-      count =  orig_data_length_;
-      memcpy(buffer.data() + buffer_index,out.data(),count );
-      buffer_index += count;
-      break;
+  // Compressed bytes that already are in memory are inflated from there.
+  // Otherwise they are read into a scratch buffer.
+  const uint8_t* compressed = nullptr;
+  if (const auto* memory = dynamic_cast<const MemoryBuffer*>(&from_file);
+      memory != nullptr && memory->Remaining() >= data_length_) {
+    compressed = memory->Current();
+  } else {
+    auto& scratch = CompressedScratch();
+    scratch.resize(data_length_);
+    const auto reads = from_file.sgetn(reinterpret_cast<char*>(scratch.data()),
+                                       static_cast<std::streamsize>(scratch.size()));
+    if (reads != static_cast<std::streamsize>(scratch.size())) {
+      return false;
     }
+    compressed = scratch.data();
+  }
 
-    case Dz4ZipType::TransposeAndDeflate: {
-     ByteArray temp(data_length_, 0);
-      fread(temp.data(),1, temp.size(), from_file);
-
-      ByteArray out(orig_data_length_, 0);
-      Inflate(temp, out);
-      InvTranspose(out, parameter_);
+  size_t size = orig_data_length_;
+  switch (static_cast<Dz4ZipType>(type_)) {
+    case Dz4ZipType::Deflate:
+      return Inflate(compressed, data_length_, dest, size) && size == orig_data_length_;
 
-      count =  orig_data_length_;
-      memcpy(buffer.data() + buffer_index,out.data(),count );
-      buffer_index += count;
-      break;
+    case Dz4ZipType::TransposeAndDeflate: {
+      auto& inflated = InflatedScratch();
+      inflated.resize(orig_data_length_);
+      if (!Inflate(compressed, data_length_, inflated.data(), size) ||
+          size != orig_data_length_) {
+        return false;
+      }
+      InvTranspose(inflated.data(), dest, size, parameter_);
+      return true;
     }
 
     default: break;
   }
-  return count;
-
+  return false;
 }
 
 }
\ No newline at end of file
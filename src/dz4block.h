@@ -21,10 +21,21 @@ class Dz4Block : public DataBlock {
     return orig_data_length_;
   }
 
+  size_t StoredSize() const override {
+    return data_length_;
+  }
+
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
-  size_t CopyDataToFile(std::FILE *from_file, std::FILE *to_file) const override;
-  size_t CopyDataToBuffer(std::FILE* from_file, std::vector<uint8_t>& buffer, size_t& buffer_index) const override;
+  size_t Read(std::streambuf& file) override;
+  size_t CopyDataToFile(std::streambuf& from_file, std::streambuf& to_file) const override;
+  /** \brief Inflates the block into a buffer.
+   *
+   * @param from_file File with the block.
+   * @param buffer Destination. Resized if too small.
+   * @param buffer_index Index in the buffer. Updated with the decoded bytes.
+   * @return Number of decoded bytes or 0 if the block fails to decode.
+   */
+  size_t CopyDataToBuffer(std::streambuf& from_file, std::vector<uint8_t>& buffer, size_t& buffer_index) const override;
 
  private:
   std::string orig_block_type_;
@@ -34,6 +45,13 @@ class Dz4Block : public DataBlock {
   uint64_t orig_data_length_ = 0;
   uint64_t data_length_ = 0;
 
+  /** \brief Inflates and inverse transposes the block into a destination.
+   *
+   * @param from_file File with the block.
+   * @param dest Destination with room for the original data length.
+   * @return True on success.
+   */
+  bool Decode(std::streambuf& from_file, uint8_t* dest) const;
 };
 }
 
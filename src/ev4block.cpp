@@ -115,20 +115,21 @@ void Ev4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Ev4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, type_);
-  bytes += ReadNumber(file, sync_type_);
-  bytes += ReadNumber(file, range_type_);
-  bytes += ReadNumber(file, cause_);
-  bytes += ReadNumber(file, flags_);
+size_t Ev4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, type_);
+  bytes += ReadNumber(data, sync_type_);
+  bytes += ReadNumber(data, range_type_);
+  bytes += ReadNumber(data, cause_);
+  bytes += ReadNumber(data, flags_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 3);
-  bytes += ReadNumber(file, length_m_);
-  bytes += ReadNumber(file, length_n_);
-  bytes += ReadNumber(file, creator_index_);
-  bytes += ReadNumber(file, sync_base_value_);
-  bytes += ReadNumber(file, sync_factor_);
+  bytes += ReadByte(data, reserved, 3);
+  bytes += ReadNumber(data, length_m_);
+  bytes += ReadNumber(data, length_n_);
+  bytes += ReadNumber(data, creator_index_);
+  bytes += ReadNumber(data, sync_base_value_);
+  bytes += ReadNumber(data, sync_factor_);
 
   name_ = ReadTx4(file,kIndexName);
   const size_t group_index = 5 + length_m_ + length_n_;
@@ -306,11 +307,11 @@ const std::vector<const IAttachment *> &Ev4Block::Attachments() const {
 
 IMetaData *Ev4Block::MetaData() {
   CreateMd4Block();
-  return dynamic_cast<IMetaData *>(md_comment_.get());
+  return dynamic_cast<IMetaData *>(MdComment());
 }
 
 const IMetaData *Ev4Block::MetaData() const {
-  return !md_comment_ ? nullptr : dynamic_cast<IMetaData *>(md_comment_.get());
+  return !md_comment_ ? nullptr : dynamic_cast<const IMetaData *>(md_comment_.get());
 }
 
 void Ev4Block::FindReferencedBlocks(const Hd4Block &hd4) {
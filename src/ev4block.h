@@ -15,7 +15,7 @@ class Ev4Block : public IBlock, public IEvent {
   Ev4Block();
 
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
   void FindReferencedBlocks(const Hd4Block& hd4);
 
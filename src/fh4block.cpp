@@ -26,10 +26,11 @@ void Fh4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Fh4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
+size_t Fh4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
   timestamp_.Init(*this);
-  bytes += timestamp_.Read(file);
+  bytes += timestamp_.Read(data);
   ReadMdComment(file, kIndexMd);
   return bytes;
 }
@@ -53,11 +54,11 @@ size_t Fh4Block::Write(std::FILE *file) {
 
 IMetaData *Fh4Block::MetaData() {
   CreateMd4Block();
-  return dynamic_cast<IMetaData *>(md_comment_.get());
+  return dynamic_cast<IMetaData *>(MdComment());
 }
 
 const IMetaData *Fh4Block::MetaData() const {
-  return !md_comment_ ? nullptr : dynamic_cast<IMetaData *>(md_comment_.get());
+  return !md_comment_ ? nullptr : dynamic_cast<const IMetaData *>(md_comment_.get());
 }
 
 int64_t Fh4Block::Index() const {
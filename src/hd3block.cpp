@@ -95,7 +95,7 @@ void Hd3Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Comment", comment_);
 }
 
-size_t Hd3Block::Read(std::FILE *file) {
+size_t Hd3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadLinks3(file, 3);
   // The for loop handles earlier versions of the MDF file
@@ -205,7 +205,7 @@ size_t Hd3Block::Write(std::FILE *file) {
   return bytes;
 }
 
-void Hd3Block::ReadMeasurementInfo(std::FILE *file) {
+void Hd3Block::ReadMeasurementInfo(std::streambuf& file) {
   dg_list_.clear();
   for (auto link = Link(kIndexDg); link > 0; /* No ++ here*/) {
     auto dg = std::make_unique<Dg3Block>();
@@ -217,7 +217,7 @@ void Hd3Block::ReadMeasurementInfo(std::FILE *file) {
   }
 }
 
-void Hd3Block::ReadEverythingButData(std::FILE *file) {
+void Hd3Block::ReadEverythingButData(std::streambuf& file) {
   // We assume that ReadMeasurementInfo have been called earlier
   for ( auto& dg : dg_list_) {
     if (!dg) {
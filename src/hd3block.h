@@ -51,11 +51,11 @@ class Hd3Block : public IBlock, public IHeader {
   [[nodiscard]] std::string Comment() const override;
   [[nodiscard]] const IBlock* Find(fpos_t index) const override;
   void GetBlockProperty(BlockPropertyList &dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
 
-  void ReadMeasurementInfo(std::FILE *file);
-  void ReadEverythingButData(std::FILE *file);
+  void ReadMeasurementInfo(std::streambuf& file);
+  void ReadEverythingButData(std::streambuf& file);
  private:
 
   uint16_t nof_dg_blocks_ = 0;
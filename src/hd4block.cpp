@@ -3,6 +3,7 @@
  * SPDX-License-Identifier: MIT
  */
 #include "hd4block.h"
+#include "blockindex.h"
 #include "util/ixmlfile.h"
 
 using namespace util::xml;
@@ -17,6 +18,11 @@ constexpr size_t kIndexEv = 4;
 constexpr size_t kIndexMd = 5;
 constexpr size_t kIndexNext = 0;
 
+// Links in the DG and CG blocks that are used when reading in file order
+constexpr size_t kIndexDgCg = 1;
+constexpr size_t kIndexCgCn = 1;
+constexpr size_t kIndexCgSr = 4;
+
 template <typename T>
 T GetCommonProperty(const mdf::detail::Hd4Block& block, const std::string &key) {
   const auto* md4 = block.Md4();
@@ -69,6 +75,12 @@ const IBlock *Hd4Block::Find(fpos_t index) const {
   if (index <= 0) {
     return nullptr;
   }
+  // Blocks that are read or written are in the file position index
+  if (block_index_ != nullptr) {
+    if (const auto* block = block_index_->Find(index); block != nullptr) {
+      return block;
+    }
+  }
 
   for (const auto& dg : dg_list_) {
     if (!dg) {
@@ -159,18 +171,19 @@ void Hd4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Hd4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
+size_t Hd4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
 
   timestamp_.Init(*this);
-  bytes += timestamp_.Read(file);
+  bytes += timestamp_.Read(data);
 
-  bytes += ReadNumber(file, time_class_);
-  bytes += ReadNumber(file, flags_);
+  bytes += ReadNumber(data, time_class_);
+  bytes += ReadNumber(data, flags_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 1);
-  bytes += ReadNumber(file, start_angle_);
-  bytes += ReadNumber(file, start_distance_);
+  bytes += ReadByte(data, reserved, 1);
+  bytes += ReadNumber(data, start_angle_);
+  bytes += ReadNumber(data, start_distance_);
 
   ReadLink4List(file, fh_list_, kIndexFh);
   ReadMdComment(file, kIndexMd);
@@ -178,31 +191,57 @@ size_t Hd4Block::Read(std::FILE *file) {
   return bytes;
 }
 
-void Hd4Block::ReadMeasurementInfo(std::FILE *file) {
+void Hd4Block::ReadMeasurementInfo(std::streambuf& file) {
   // We assume that the ID and HD block have been read (see ReadHeader)
   // Special handling of DG blocks.
   ReadLink4List(file,dg_list_, kIndexDg);
+  std::vector<ReadJob> job_list;
   for (auto& dg4 : dg_list_) {
-    dg4->ReadCgList(file);
+    auto* dg = dg4.get();
+    job_list.emplace_back(dg->Link(kIndexDgCg), [&file, dg] { dg->ReadCgList(file); });
   }
+  ReadInFileOrder(file, job_list);
   ReadLink4List(file,at_list_, kIndexAt);
 }
 
-void Hd4Block::ReadEverythingButData(std::FILE *file) {
-  // We assume that ReadMeasurementInfo have been called earlier
+void Hd4Block::ReadEverythingButData(std::streambuf& file, const LazyFile* lazy_file,
+                                     const ParallelRead* parallel) {
+  // We assume that ReadMeasurementInfo have been called earlier.
+  // The channel groups are independent, so their lists are read in file order.
+  // Each data group is one group of jobs, that may be read by its own thread.
+  std::vector<std::vector<ParallelJob>> group_list;
   for ( auto& dg : dg_list_) {
     if (!dg) {
       continue;
     }
-    for (auto& cg : dg->Cg4()) {
-      cg->ReadCnList(file);
-      cg->ReadSrList(file);
+    auto& job_list = group_list.emplace_back();
+    for (auto& cg4 : dg->Cg4()) {
+      auto* cg = cg4.get();
+      if (lazy_file != nullptr) {
+        cg->SetLazyFile(lazy_file);
+        continue;
+      }
+      job_list.emplace_back(cg->Link(kIndexCgCn), [cg] (std::streambuf& dg_file) { cg->ReadCnList(dg_file); });
+      job_list.emplace_back(cg->Link(kIndexCgSr), [cg] (std::streambuf& dg_file) { cg->ReadSrList(dg_file); });
+    }
+  }
+  std::erase_if(group_list, [] (const auto& job_list) { return job_list.empty(); });
+  if (parallel != nullptr && parallel->nof_threads > 1 && group_list.size() > 1) {
+    ReadInParallel(*parallel, group_list);
+  } else {
+    std::vector<ReadJob> job_list;
+    for (const auto& group : group_list) {
+      for (const auto& [link, read] : group) {
+        job_list.emplace_back(link, [&file, &read] { read(file); });
+      }
     }
+    ReadInFileOrder(file, job_list);
   }
   // Must read in all channels before creating CH block that references the CN blocks
   ReadLink4List(file,ch_list_, kIndexCh);
   ReadLink4List(file,ev_list_, kIndexEv);
-  // Need to scan through the event and hierarchy blocks to find the referenced blocks
+  // Need to scan through the event and hierarchy blocks to find the referenced blocks.
+  // Deferred channel lists are read if a block isn't found.
   for (auto& ch4 : ch_list_) {
     ch4->FindReferencedBlocks(*this);
   }
@@ -297,11 +336,11 @@ uint64_t Hd4Block::StartTime() const {
 
 IMetaData* Hd4Block::MetaData() {
   CreateMd4Block();
-  return dynamic_cast<IMetaData*>(md_comment_.get());
+  return dynamic_cast<IMetaData*>(MdComment());
 }
 
 const IMetaData* Hd4Block::MetaData() const {
-  return md_comment_ ? dynamic_cast<IMetaData*>(md_comment_.get()) : nullptr;
+  return md_comment_ ? dynamic_cast<const IMetaData*>(md_comment_.get()) : nullptr;
 }
 
 IDataGroup *Hd4Block::LastDataGroup() const {
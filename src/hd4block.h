@@ -112,11 +112,18 @@ class Hd4Block : public IBlock, public IHeader {
   [[nodiscard]] const IBlock* Find(fpos_t index) const override;
   void GetBlockProperty(BlockPropertyList &dest) const override;
 
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE* file) override;
 
-  void ReadMeasurementInfo(std::FILE *file);
-  void ReadEverythingButData(std::FILE *file);
+  void ReadMeasurementInfo(std::streambuf& file);
+  /** \brief Reads the CN, SR, CH and EV blocks.
+   *
+   * @param file File to read from.
+   * @param lazy_file If set, the CN and SR lists are read on first access.
+   * @param parallel If set, the data groups are read in parallel.
+   */
+  void ReadEverythingButData(std::streambuf& file, const LazyFile* lazy_file = nullptr,
+                             const ParallelRead* parallel = nullptr);
 
   [[nodiscard]] IEvent *CreateEvent() override;
   [[nodiscard]] std::vector<IEvent *> Events() const override;
@@ -39,12 +39,13 @@ void Hl4Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Zip Type", MakeZipTypeString(type_));
 }
 
-size_t Hl4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, flags_);
-  bytes += ReadNumber(file, type_);
+size_t Hl4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, flags_);
+  bytes += ReadNumber(data, type_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 5);
+  bytes += ReadByte(data, reserved, 5);
   ReadBlockList(file, kIndexData);
   return bytes;
 }
@@ -9,7 +9,7 @@ namespace mdf::detail {
 class Hl4Block : public DataListBlock {
  public:
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
  private:
   uint16_t flags_ = 0;
   uint8_t type_ = 0;
@@ -3,20 +3,77 @@
  * SPDX-License-Identifier: MIT
  */
 #include <string>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <mutex>
 #include <sstream>
 #include <ios>
 #include <thread>
 #include <chrono>
+#include <filesystem>
+#ifdef WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // std::min and std::max
+#endif
+#include <windows.h>
+#endif
 #include <boost/algorithm/string.hpp>
 #include <util/ixmlfile.h>
 #include <util/logstream.h>
 #include "iblock.h"
+#include "blockindex.h"
+#include "ireadahead.h"
 #include "md4block.h"
 #include "tx3block.h"
 
 using namespace std::chrono_literals;
 using namespace util::log;
 
+namespace {
+constexpr size_t kHeader3Size = 4; ///< Block type and size
+constexpr size_t kHeader4Size = 24; ///< Block type, reserved, length and link count
+constexpr size_t kReadAheadSize = 4096; ///< Read-ahead hint size for one block
+constexpr size_t kMaxYields = 1'000; ///< Yields before the yield mode starts to sleep
+constexpr auto kMaxSleep = 10ms; ///< Longest sleep between open attempts
+
+/// Clears the error codes before an open attempt.
+void ClearOpenError() {
+  errno = 0;
+#ifdef WIN32
+  SetLastError(ERROR_SUCCESS);
+#endif
+}
+
+/// Returns true if the last open attempt failed because the file is locked.
+bool IsLockError() {
+#ifdef WIN32
+  switch (GetLastError()) {
+    case ERROR_SHARING_VIOLATION:
+    case ERROR_LOCK_VIOLATION:
+      return true;
+
+    default:
+      break;
+  }
+#endif
+  switch (errno) {
+    case EACCES:
+    case EEXIST:
+    case EAGAIN:
+    case EBUSY:
+      return true;
+
+    default:
+      break;
+  }
+  return false;
+}
+
+}
+
 namespace mdf::detail {
 
 std::fpos_t GetFilePosition(std::FILE *file) {
@@ -67,7 +124,31 @@ size_t StepFilePosition(std::FILE *file, size_t steps) {
   return steps;
 }
 
-std::string ReadBlockType(std::FILE *file) {
+int64_t GetFilePosition(std::streambuf& file) {
+  const auto curr = file.pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+  if (curr == std::streampos(-1)) {
+    throw std::ios_base::failure("Failed to get a file position");
+  }
+  return static_cast<int64_t>(curr);
+}
+
+void SetFilePosition(std::streambuf& file, int64_t position) {
+  // Fast check if it already is in position
+  if (GetFilePosition(file) == position) {
+    return;
+  }
+  const auto set = file.pubseekpos(position, std::ios_base::in);
+  if (set == std::streampos(-1) || static_cast<int64_t>(set) != position) {
+    throw std::ios_base::failure("Failed to set a file position");
+  }
+}
+
+size_t StepFilePosition(std::streambuf& file, size_t steps) {
+  file.pubseekoff(static_cast<std::streamoff>(steps), std::ios_base::cur, std::ios_base::in);
+  return steps;
+}
+
+std::string ReadBlockType(std::streambuf& file) {
   std::string type3;
   ReadStr(file,type3,2);
   if (type3 == "##") {
@@ -78,13 +159,13 @@ std::string ReadBlockType(std::FILE *file) {
   return type3;
 }
 
-std::size_t ReadByte(std::FILE *file, std::vector<uint8_t> &dest, const size_t size) {
+std::size_t ReadByte(std::streambuf& file, std::vector<uint8_t> &dest, const size_t size) {
   if (size == 0) {
     dest.clear();
     return 0;
   }
   dest.resize(size, 0);
-  std::fread(dest.data(), 1, size, file);
+  file.sgetn(reinterpret_cast<char*>(dest.data()), static_cast<std::streamsize>(size));
   return size;
 }
 
@@ -101,23 +182,18 @@ std::size_t WriteBytes(std::FILE *file, size_t nof_bytes) {
   return bytes;
 }
 
-size_t ReadStr(std::FILE *file, std::string &dest, const size_t size) {
-  std::ostringstream temp;
-  char in = '\0';
-  for (size_t ii = 0; ii < size; ++ii) {
-    auto byte = std::fread(&in, 1, 1, file);
-    if (byte != 1) {
-      std::ostringstream error;
-      error << "Failed to read an MDF string. "
-               "In byte " << ii << " of " << size << ".";
-      throw std::ios_base::failure(error.str());
-    }
-    if (in != '\0') {
-      temp << in;
-    }
+size_t ReadStr(std::streambuf& file, std::string &dest, const size_t size) {
+  std::string temp(size, '\0');
+  const auto count = file.sgetn(temp.data(), static_cast<std::streamsize>(size));
+  if (count != static_cast<std::streamsize>(size)) {
+    std::ostringstream error;
+    error << "Failed to read an MDF string. "
+             "Read " << count << " of " << size << " bytes.";
+    throw std::ios_base::failure(error.str());
   }
-  dest = temp.str();
-  boost::trim(dest);
+  temp.erase(std::remove(temp.begin(), temp.end(), '\0'), temp.end());
+  boost::trim(temp);
+  dest = std::move(temp);
   return size;
 }
 
@@ -144,6 +220,74 @@ std::string ToMd5String(const std::vector<uint8_t>& md5)
   return temp.str();
 }
 
+void ReadInFileOrder(std::streambuf& file, std::vector<ReadJob>& job_list) {
+  std::erase_if(job_list, [] (const auto& job) { return job.first <= 0; });
+  std::ranges::stable_sort(job_list, {}, &ReadJob::first);
+
+  if (const auto* read_ahead = dynamic_cast<const IReadAhead*>(&file);
+      read_ahead != nullptr && !job_list.empty()) {
+    // Blocks that are close to each other share one hint
+    auto start = job_list.front().first;
+    auto end = start + static_cast<int64_t>(kReadAheadSize);
+    for (const auto& [link, read] : job_list) {
+      if (link > end) {
+        read_ahead->WillNeed(start, static_cast<size_t>(end - start));
+        start = link;
+      }
+      end = link + static_cast<int64_t>(kReadAheadSize);
+    }
+    read_ahead->WillNeed(start, static_cast<size_t>(end - start));
+  }
+
+  for (auto& [link, read] : job_list) {
+    read();
+  }
+}
+
+void ReadInParallel(const ParallelRead& parallel,
+                    const std::vector<std::vector<ParallelJob>>& group_list) {
+  std::atomic<size_t> next_group = 0;
+  std::mutex error_locker;
+  std::exception_ptr error;
+  auto* arena = BlockArena::Current();
+
+  auto worker = [&] {
+    try {
+      BlockArena::Scope arena_scope(arena);
+      auto file = parallel.opener ? parallel.opener() : std::unique_ptr<std::streambuf>();
+      if (!file) {
+        throw std::ios_base::failure("Failed to open the file");
+      }
+      for (auto group = next_group++; group < group_list.size(); group = next_group++) {
+        std::vector<ReadJob> job_list;
+        for (const auto& [link, read] : group_list[group]) {
+          job_list.emplace_back(link, [&file, &read] { read(*file); });
+        }
+        ReadInFileOrder(*file, job_list);
+      }
+    } catch (...) {
+      std::lock_guard lock(error_locker);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next_group = group_list.size(); // Stop the other threads
+    }
+  };
+
+  const auto nof_threads = std::min(parallel.nof_threads, group_list.size());
+  std::vector<std::thread> thread_list;
+  for (size_t thread = 1; thread < nof_threads; ++thread) {
+    thread_list.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : thread_list) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
 bool OpenMdfFile(FILE *&file, const std::string &filename, const std::string &mode) {
   if (file != nullptr) {
     fclose(file);
@@ -191,55 +335,194 @@ bool OpenMdfFile(FILE *&file, const std::string &filename, const std::string &mo
 
 }
 
+bool OpenWithLockWait(const std::string &filename, const std::function<bool()> &open,
+                      LockWaitMode wait, std::chrono::milliseconds timeout) {
+  const auto start = std::chrono::steady_clock::now();
+  std::chrono::milliseconds sleep = 1ms;
+  for (size_t attempt = 0; true; ++attempt) {
+    ClearOpenError();
+    if (open()) {
+      return true;
+    }
+    const int error = errno;
+    const bool locked = IsLockError();
+    std::error_code err;
+    if (!std::filesystem::exists(filename, err)) {
+      LOG_ERROR() << "File doesn't exist. File: " << filename;
+      return false;
+    }
+    if (!locked || wait == LockWaitMode::NoWait) {
+      LOG_ERROR() << "Failed to open the file. File: " << filename
+                  << ". Error: " << std::strerror(error) << " (" << error << ")";
+      return false;
+    }
+    // The file is locked by a writer
+    if (std::chrono::steady_clock::now() - start >= timeout) {
+      LOG_ERROR() << "Failed to open the file due to lock timeout ("
+                  << timeout.count() << " ms). File: " << filename;
+      return false;
+    }
+    if (wait == LockWaitMode::Yield && attempt < kMaxYields) {
+      std::this_thread::yield();
+    } else if (wait == LockWaitMode::Yield) {
+      // Don't spin a core for the whole timeout
+      std::this_thread::sleep_for(sleep);
+      sleep = std::min<std::chrono::milliseconds>(sleep * 2, kMaxSleep);
+    } else {
+      std::this_thread::sleep_for(kMaxSleep);
+    }
+  }
+}
+
+bool OpenMdfFile(std::filebuf &file, const std::string &filename, std::ios_base::openmode mode,
+                 LockWaitMode wait, std::chrono::milliseconds timeout) {
+  if (file.is_open()) {
+    file.close();
+  }
+  return OpenWithLockWait(filename, [&] { return file.open(filename, mode) != nullptr; },
+                          wait, timeout);
+}
+
 bool IBlock::IsBigEndian() const {
   return byte_order_ != 0;
 }
 
-size_t IBlock::ReadHeader3(std::FILE *file) {
+size_t IBlock::ReadHeader3(std::streambuf& file) {
   file_position_ = GetFilePosition(file);
-  size_t bytes = ReadStr(file, block_type_, 2);
-  bytes += ReadNumber(file, block_size_);
+  if (block_index_ != nullptr) {
+    block_index_->Add(this);
+  }
+  BlockBuffer header;
+  header.Load(file, file_position_, kHeader3Size);
+  std::string block_type;
+  size_t bytes = ReadStr(header, block_type, 2);
+  block_type_ = block_type;
+  bytes += ReadNumber(header, block_size_);
   block_length_ = block_size_;
   return bytes;
 }
 
-size_t IBlock::ReadLinks3(std::FILE* file, size_t nof_links) {
+size_t IBlock::ReadLinks3(std::streambuf& file, size_t nof_links) {
+  BlockBuffer links;
+  links.Load(file, GetFilePosition(file), nof_links * 4);
   size_t bytes = 0;
   link_list_.clear();
+  link_list_.reserve(nof_links);
   for (size_t ii = 0; ii < nof_links; ++ii) {
     uint32_t link = 0;
-    bytes += ReadNumber(file, link);
+    bytes += ReadNumber(links, link);
     link_list_.emplace_back(link);
   }
   link_count_ = link_list_.size();
   return bytes;
 }
 
-size_t IBlock::ReadHeader4(std::FILE *file) {
+size_t IBlock::ReadFixedHeader4(std::streambuf& file) {
   file_position_ = GetFilePosition(file);
-  size_t bytes = ReadStr(file, block_type_, 4);
+  if (block_index_ != nullptr) {
+    block_index_->Add(this);
+  }
+  BlockBuffer header;
+  header.Load(file, file_position_, kHeader4Size);
+  std::string block_type;
+  size_t bytes = ReadStr(header, block_type, 4);
+  block_type_ = block_type;
   uint32_t reserved = 0;
-  bytes += ReadNumber(file, reserved);
-  bytes += ReadNumber(file, block_length_);
-  bytes += ReadNumber(file, link_count_);
+  bytes += ReadNumber(header, reserved);
+  bytes += ReadNumber(header, block_length_);
+  bytes += ReadNumber(header, link_count_);
 
   block_size_ = static_cast<uint16_t> (block_length_);
+  return bytes;
+}
+
+void IBlock::CheckBlockLength() const {
+  // The link count is checked before it is multiplied, so it can't overflow
+  if (block_length_ < kHeader4Size ||
+      link_count_ > (block_length_ - kHeader4Size) / 8) {
+    throw std::ios_base::failure("Invalid block length");
+  }
+}
 
+size_t IBlock::ReadLinks4(std::streambuf& buffer) {
+  size_t bytes = 0;
   link_list_.clear();
+  link_list_.reserve(link_count_);
   for (uint64_t ii = 0; ii < link_count_; ++ii) {
     int64_t link = 0;
-    bytes += ReadNumber(file, link);
+    bytes += ReadNumber(buffer, link);
     link_list_.emplace_back(link);
   }
   return bytes;
 }
 
+size_t IBlock::ReadHeader4(std::streambuf& file) {
+  size_t bytes = ReadFixedHeader4(file);
+  CheckBlockLength();
+  BlockBuffer links;
+  links.Load(file, file_position_ + kHeader4Size, link_count_ * 8);
+  bytes += ReadLinks4(links);
+  return bytes;
+}
+
+size_t IBlock::ReadHeader4(std::streambuf& file, BlockBuffer& data) {
+  size_t bytes = ReadFixedHeader4(file);
+  CheckBlockLength();
+  data.Load(file, file_position_ + kHeader4Size, block_length_ - kHeader4Size);
+  bytes += ReadLinks4(data);
+  return bytes;
+}
+
+int64_t IBlock::ReadLink4(std::streambuf& file, size_t link_index) const {
+  SetFilePosition(file, file_position_ + static_cast<int64_t>(kHeader4Size + (link_index * 8)));
+  int64_t link = 0;
+  ReadNumber(file, link);
+  return link;
+}
+
+std::string IBlock::ReadBlockHeader4(std::streambuf& file, int64_t position,
+                                     uint64_t& block_length, uint64_t& nof_links) const {
+  SetFilePosition(file, position);
+  BlockBuffer header;
+  header.Load(file, position, kHeader4Size);
+  std::string block_type;
+  ReadStr(header, block_type, 4);
+  uint32_t reserved = 0;
+  ReadNumber(header, reserved);
+  ReadNumber(header, block_length);
+  ReadNumber(header, nof_links);
+  return block_type;
+}
+
+bool IBlock::IsLastBlock(int64_t position) const {
+  return block_index_ == nullptr || position >= block_index_->LastPosition();
+}
+
+void *IBlock::operator new(size_t size) {
+  return BlockArena::AllocateBlock(size);
+}
+
+void IBlock::operator delete(void *block) {
+  BlockArena::FreeBlock(block);
+}
+
+IBlock::~IBlock() {
+  if (block_index_ != nullptr) {
+    block_index_->Remove(this);
+  }
+}
+
 void IBlock::Init(const IBlock &id_block) {
   byte_order_ = id_block.byte_order_;
   version_ = id_block.version_;
+  block_index_ = id_block.block_index_;
+}
+
+void IBlock::SetBlockIndex(BlockIndex *block_index) {
+  block_index_ = block_index;
 }
 
-std::size_t IBlock::ReadBool(std::FILE *file, bool &dest) const {
+std::size_t IBlock::ReadBool(std::streambuf& file, bool &dest) const {
   uint16_t temp = 0;
   auto bytes = ReadNumber(file, temp);
   dest = temp != 0;
@@ -251,20 +534,40 @@ std::size_t IBlock::WriteBool(std::FILE *file, bool value) const {
   return WriteNumber(file, temp);
 }
 
-void IBlock::ReadMdComment(std::FILE *file, size_t index_md) {
+void IBlock::ReadMdComment(std::streambuf& file, size_t index_md) {
   if (!md_comment_ && Link(index_md) > 0) {
-    md_comment_ = std::move(std::make_unique<Md4Block>());
-    md_comment_->Init(*this);
-    SetFilePosition(file, Link(index_md));
-    md_comment_->Read(file);
+    md_comment_ = ReadSharedBlock4<Md4Block>(file, index_md);
+    md_owned_ = nullptr;
   }
 }
 
 void IBlock::WriteMdComment(std::FILE *file, size_t index_md) {
   if (md_comment_ && Link(index_md) == 0) {
-    md_comment_->Write(file);
-    UpdateLink(file, index_md, md_comment_->FilePosition());
+    auto* md_comment = MdComment();
+    md_comment->Write(file);
+    UpdateLink(file, index_md, md_comment->FilePosition());
+  }
+}
+
+IBlock* IBlock::MdComment() {
+  if (md_comment_ && md_owned_ == nullptr) {
+    std::unique_ptr<IBlock> copy;
+    if (const auto* md4 = dynamic_cast<const Md4Block*>(md_comment_.get()); md4 != nullptr) {
+      copy = std::make_unique<Md4Block>(*md4);
+    } else if (const auto* tx4 = dynamic_cast<const Tx4Block*>(md_comment_.get()); tx4 != nullptr) {
+      copy = std::make_unique<Tx4Block>(*tx4);
+    } else {
+      return nullptr;
+    }
+    copy->block_index_ = nullptr; // Only the shared block is in the index
+    MdComment(std::move(copy));
   }
+  return md_owned_;
+}
+
+void IBlock::MdComment(std::unique_ptr<IBlock> md_comment) {
+  md_owned_ = md_comment.get();
+  md_comment_ = std::move(md_comment);
 }
 
 void IBlock::WriteTx4(std::FILE *file, size_t index_tx, const std::string& text) {
@@ -276,7 +579,7 @@ void IBlock::WriteTx4(std::FILE *file, size_t index_tx, const std::string& text)
   }
 }
 
-std::string IBlock::ReadTx3(std::FILE *file, size_t index_tx) const {
+std::string IBlock::ReadTx3(std::streambuf& file, size_t index_tx) const {
   if (Link(index_tx) > 0) {
     SetFilePosition(file, Link(index_tx));
     Tx3Block tx;
@@ -287,7 +590,7 @@ std::string IBlock::ReadTx3(std::FILE *file, size_t index_tx) const {
   return {};
 }
 
-std::string IBlock::ReadTx4(std::FILE *file, size_t index_tx) const {
+std::string IBlock::ReadTx4(std::streambuf& file, size_t index_tx) const {
   if (Link(index_tx) > 0) {
     SetFilePosition(file, Link(index_tx));
     Tx4Block tx;
@@ -303,8 +606,7 @@ const Md4Block *IBlock::Md4() const {
 }
 
 void IBlock::Md4(const std::string &xml) {
-  auto md4 = std::make_unique<Md4Block>(xml);
-  md_comment_ = std::move(md4);
+  MdComment(std::make_unique<Md4Block>(xml));
 }
 
 std::string IBlock::Comment() const {
@@ -348,6 +650,9 @@ size_t IBlock::Write(std::FILE *file) {
   }
   SetLastFilePosition(file);
   file_position_ = GetFilePosition(file);
+  if (block_index_ != nullptr) {
+    block_index_->Add(this);
+  }
 
   size_t bytes = 0;
   if (IsMdf4()) {
@@ -479,7 +784,7 @@ void IBlock::CreateMd4Block() {
   }
 
   md4->XmlSnippet(xml->WriteString(true));
-  md_comment_ =  std::move(md4);
+  MdComment(std::move(md4));
 }
 
 std::string IBlock::BlockType() const {
@@ -491,7 +796,7 @@ std::string IBlock::BlockType() const {
 
 IMetaData *IBlock::MetaData() {
   CreateMd4Block();
-  return dynamic_cast<IMetaData *>(md_comment_.get());
+  return dynamic_cast<IMetaData *>(MdComment());
 }
 
 const IMetaData *IBlock::MetaData() const {
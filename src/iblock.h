@@ -9,12 +9,22 @@
 #include <sstream>
 #include <iomanip>
 #include <cstdio>
+#include <streambuf>
+#include <fstream>
+#include <functional>
+#include <chrono>
 
 #include <boost/endian/conversion.hpp>
 #include <boost/endian/buffers.hpp>
 
 #include "blockproperty.h"
+#include "blockarena.h"
+#include "blockindex.h"
+#include "blocktypeid.h"
+#include "linklist.h"
+#include "memorybuffer.h"
 #include "mdf/imetadata.h"
+#include "mdf/lockwaitmode.h"
 
 namespace mdf::detail {
 
@@ -27,12 +37,64 @@ void SetFirstFilePosition(std::FILE *file);
 
 size_t StepFilePosition(std::FILE* file, size_t steps);
 
-[[nodiscard]] std::string ReadBlockType(std::FILE* file);
-std::size_t ReadByte(std::FILE *file, std::vector<uint8_t> &dest, size_t size);
+int64_t GetFilePosition(std::streambuf& file);
+void SetFilePosition(std::streambuf& file, int64_t position);
+size_t StepFilePosition(std::streambuf& file, size_t steps);
+
+[[nodiscard]] std::string ReadBlockType(std::streambuf& file);
+std::size_t ReadByte(std::streambuf& file, std::vector<uint8_t> &dest, size_t size);
 std::size_t WriteByte(std::FILE *file, const std::vector<uint8_t>& source);
 std::size_t WriteBytes(std::FILE *file, size_t nof_bytes);
 
-std::size_t ReadStr(std::FILE *file, std::string &dest, size_t size);
+std::size_t ReadStr(std::streambuf& file, std::string &dest, size_t size);
+
+/** \brief Read function for a linked block.
+ *
+ * The first value is the file position (link) of the block, the second
+ * value is the function that reads the block.
+ */
+using ReadJob = std::pair<int64_t, std::function<void()>>;
+
+/** \brief Reads linked blocks in ascending file position order.
+ *
+ * Blocks that don't depend on each other, may be read in any order. Reading
+ * them in file order, gives a forward going read pattern instead of random
+ * seeks. Read-ahead hints for all the blocks are given to the stream buffer
+ * before the reading starts, if the buffer supports it (see IReadAhead).
+ * Jobs with null links are ignored.
+ * @param file File stream buffer.
+ * @param job_list List of read jobs. The list is sorted by the function.
+ */
+void ReadInFileOrder(std::streambuf& file, std::vector<ReadJob>& job_list);
+
+/// Opens a file stream buffer with its own file position. Returns null on failure.
+using FileOpener = std::function<std::unique_ptr<std::streambuf>()>;
+
+/** \brief Read function for a linked block that reads from a worker file.
+ *
+ * Same as a ReadJob but the function gets the file to read from.
+ */
+using ParallelJob = std::pair<int64_t, std::function<void(std::streambuf&)>>;
+
+/** \brief Settings for reading independent blocks in parallel.
+ */
+struct ParallelRead {
+  size_t nof_threads = 0; ///< Max number of threads. Less than 2 means no threads.
+  FileOpener opener; ///< Opens one file for each thread.
+};
+
+/** \brief Reads groups of independent blocks in parallel.
+ *
+ * Each thread opens its own file and then reads one group at a time. The
+ * jobs in a group are read in file order, see ReadInFileOrder(). The
+ * calling thread is one of the threads. Any block arena of the calling
+ * thread is used by all threads. The first error is thrown when all
+ * threads are done.
+ * @param parallel Number of threads and the file opener.
+ * @param group_list Groups of read jobs.
+ */
+void ReadInParallel(const ParallelRead& parallel,
+                    const std::vector<std::vector<ParallelJob>>& group_list);
 std::size_t WriteStr(std::FILE *file, const std::string &source, size_t size);
 
 template <typename T>
@@ -74,10 +136,43 @@ std::string ToMd5String(const std::vector<uint8_t>& md5);
  */
 bool OpenMdfFile(std::FILE* &file, const std::string& filename, const std::string& mode);
 
+/** \brief Support function that opens a file that may be locked.
+ *
+ * The open function is called until it succeeds, fails with an error that
+ * isn't a lock error, or the lock wait times out. The wait between the attempts depends on the
+ * wait mode.
+ * @param filename Full path to file.
+ * @param open Function that tries to open the file.
+ * @param wait Wait strategy between the attempts.
+ * @param timeout Maximum time to wait for the file.
+ * @return True if the file was opened.
+ */
+bool OpenWithLockWait(const std::string& filename, const std::function<bool()>& open,
+                      LockWaitMode wait, std::chrono::milliseconds timeout);
+
+/** \brief Support function for opening an MDF file stream buffer.
+ *
+ * Same as above but opens a file stream buffer. This is used when reading
+ * a file.
+ * @param file Reference to a file stream buffer.
+ * @param filename Full path to file.
+ * @param mode Open mode.
+ * @param wait Wait strategy if the file is locked.
+ * @param timeout Maximum time to wait for a locked file.
+ * @return True if the file was opened.
+ */
+bool OpenMdfFile(std::filebuf& file, const std::string& filename, std::ios_base::openmode mode,
+                 LockWaitMode wait = LockWaitMode::Sleep,
+                 std::chrono::milliseconds timeout = std::chrono::seconds(60));
+
 class IBlock {
  public:
 
-  virtual ~IBlock() = default;
+  virtual ~IBlock();
+
+  /// Allocates the block from the current block arena, if any.
+  static void* operator new(size_t size);
+  static void operator delete(void* block);
 
   virtual void GetBlockProperty(BlockPropertyList& dest) const;
   [[nodiscard]] virtual const IBlock* Find(fpos_t index) const;
@@ -101,6 +196,14 @@ class IBlock {
    */
   virtual void Init(const IBlock &id_block);
 
+  /** \brief Sets the file position index.
+   *
+   * The block adds itself to the index when it is read or written. Blocks
+   * initialized from this block (see Init()) use the same index.
+   * @param block_index Index owned by the file object.
+   */
+  void SetBlockIndex(BlockIndex* block_index);
+
   [[nodiscard]] bool IsBigEndian() const;
 
   [[nodiscard]] uint16_t Version() const {
@@ -111,10 +214,10 @@ class IBlock {
     return link_list_.size() > ii ? link_list_[ii] : 0;
   }
 
-  [[nodiscard]] const Md4Block *Md4() const;
+  [[nodiscard]] virtual const Md4Block *Md4() const;
   void  Md4(const std::string& xml);
 
-  virtual size_t Read(std::FILE *file) = 0;
+  virtual size_t Read(std::streambuf& file) = 0;
   virtual size_t Write(std::FILE *file);
   size_t Update(std::FILE* file);
   void UpdateLink(std::FILE* file, size_t link_index, int64_t link);
@@ -127,35 +230,92 @@ class IBlock {
    */
   uint16_t byte_order_ = 0; ///< Default set to Intel (little) byte order.
   uint16_t version_ = 420;  ///< Default set to 4.2.
+  uint16_t block_size_ = 0;     ///< MDF3 16-bit block size.
+  BlockTypeId block_type_;      ///< MDF header. MDF3 has 2 characters. MDF4 has 4 characters.
 
   fpos_t file_position_ = 0;       ///< 64-bit file position.
-  std::string block_type_;         ///< MDF header. MDF3 has 2 characters. MDF4 has 4 characters.
-  uint16_t block_size_ = 0;     ///< MDF3 16-bit block size.
   uint64_t block_length_ = 0;   ///< MDF4 64-bit block size.
   uint64_t link_count_ = 0;     ///< MDF4 number of links.
-  std::vector<int64_t> link_list_; ///< MDF link list
+  LinkList link_list_; ///< MDF link list
 
-  std::unique_ptr<IBlock> md_comment_; ///< Most MDF4 block has a MD block referenced
+  /// Most MDF4 block has a MD block referenced. A block read from a file may
+  /// be shared by many blocks, so it is immutable. See MdComment().
+  std::shared_ptr<const IBlock> md_comment_;
+  IBlock* md_owned_ = nullptr; ///< Same block as md_comment_ if this block owns it.
+  BlockIndex* block_index_ = nullptr; ///< File position index. Owned by the file object.
 
   IBlock() = default;
 
   [[nodiscard]] bool IsMdf4() const;
-  size_t ReadHeader3(std::FILE *file); ///< Reads a MDF3 block header.
-  size_t ReadLinks3(std::FILE* file, size_t nof_links); ///< Reads MDF3 links into the link list.
 
-  size_t ReadHeader4(std::FILE *file); ///< Read in MDF4 header and links.
+  /** \brief Returns the MD (comment) block for editing.
+   *
+   * A shared MD block is first copied (copy on write), so editing the
+   * comment doesn't change the comment of other blocks.
+   * @return The MD block or null if the block has no comment.
+   */
+  [[nodiscard]] IBlock* MdComment();
+  void MdComment(std::unique_ptr<IBlock> md_comment); ///< Sets an owned MD block.
+
+  size_t ReadHeader3(std::streambuf& file); ///< Reads a MDF3 block header.
+  size_t ReadLinks3(std::streambuf& file, size_t nof_links); ///< Reads MDF3 links into the link list.
 
-  void ReadMdComment(std::FILE *file, size_t index_md);
+  size_t ReadHeader4(std::streambuf& file); ///< Read in MDF4 header and links.
+
+  /** \brief Reads the MDF4 header, links and the data section.
+   *
+   * The fixed 24 byte header is read first. The links and the data
+   * section are then read with one read into the data buffer. The links are
+   * decoded and the data buffer is positioned at the start of the data
+   * section. This should not be used for blocks with large data sections
+   * as DT or AT blocks.
+   * @param file File to read from.
+   * @param data Buffer with the data section.
+   * @return Number of bytes in the header and links.
+   */
+  size_t ReadHeader4(std::streambuf& file, BlockBuffer& data);
+
+  /** \brief Reads a link of this block from the file.
+   *
+   * Used by follow mode, as the writer of an unfinished file may update the
+   * links after the file was opened.
+   * @param file File to read from.
+   * @param link_index Index of the link.
+   * @return The link in the file.
+   */
+  [[nodiscard]] int64_t ReadLink4(std::streambuf& file, size_t link_index) const;
+
+  /** \brief Reads the 24 byte MDF4 header of another block.
+   *
+   * Used by follow mode to find the current length of a data block.
+   * @param file File to read from.
+   * @param position File position of the block.
+   * @param block_length Returns the block length.
+   * @param nof_links Returns the number of links.
+   * @return The block type as "##DT".
+   */
+  std::string ReadBlockHeader4(std::streambuf& file, int64_t position,
+                               uint64_t& block_length, uint64_t& nof_links) const;
+
+  /** \brief Returns true if no known block is stored after the position.
+   *
+   * Only blocks that have been read are known.
+   * @param position File position of a block.
+   * @return True if the block is the last block in the file.
+   */
+  [[nodiscard]] bool IsLastBlock(int64_t position) const;
+
+  void ReadMdComment(std::streambuf& file, size_t index_md);
   void WriteMdComment(std::FILE* file, size_t index_md);
 
-  std::string ReadTx3(std::FILE *file, size_t index_tx) const;
-  std::string ReadTx4(std::FILE *file, size_t index_tx) const;
+  std::string ReadTx3(std::streambuf& file, size_t index_tx) const;
+  std::string ReadTx4(std::streambuf& file, size_t index_tx) const;
   void WriteTx4(std::FILE *file, size_t index_tx, const std::string& text);
 
-  std::size_t ReadBool(std::FILE *file, bool &dest) const;
+  std::size_t ReadBool(std::streambuf& file, bool &dest) const;
   std::size_t WriteBool(std::FILE* file, bool value) const;
 
-  [[nodiscard]] std::string MdText() const;
+  [[nodiscard]] virtual std::string MdText() const;
 
   [[nodiscard]] virtual IMetaData *MetaData();
   [[nodiscard]] virtual const IMetaData *MetaData() const;
@@ -164,18 +324,18 @@ class IBlock {
   void CreateMd4Block(); ///< Helper function that creates an MD4 block to this block
 
   template<typename T>
-  std::size_t ReadNumber(std::FILE *file, T &dest) const {
+  std::size_t ReadNumber(std::streambuf& file, T &dest) const {
     if (IsBigEndian()) {
       boost::endian::endian_buffer<boost::endian::order::big, T, sizeof(T) * 8> buff;
-      auto count = std::fread(buff.data(), sizeof(T), 1, file);
-      if (count != 1) {
+      auto count = file.sgetn(reinterpret_cast<char*>(buff.data()), sizeof(T));
+      if (count != sizeof(T)) {
         throw std::ios_base::failure("Invalid number of bytes read");
       }
       dest = buff.value();
     } else {
       boost::endian::endian_buffer<boost::endian::order::little, T, sizeof(T) * 8> buff;
-      auto count = std::fread(buff.data(), sizeof(T), 1, file);
-      if (count != 1) {
+      auto count = file.sgetn(reinterpret_cast<char*>(buff.data()), sizeof(T));
+      if (count != sizeof(T)) {
         throw std::ios_base::failure("Invalid number of bytes read");
       }
       dest = buff.value();
@@ -208,12 +368,12 @@ class IBlock {
  *
  * Helper function that reads a list of MDF4 blocks from a file.
  * @tparam T Block type
- * @param file File stream pointer.
+ * @param file File stream buffer.
  * @param block_list List of blocks.
  * @param link_index Link index to the first block.
  */
   template<typename T>
-  void ReadLink4List(std::FILE* file, std::vector<std::unique_ptr<T>> &block_list, size_t link_index);
+  void ReadLink4List(std::streambuf& file, std::vector<std::unique_ptr<T>> &block_list, size_t link_index);
 
   /** \brief Writes a list of blocks to the file.
    *
@@ -228,12 +388,36 @@ class IBlock {
   void WriteLink4List(std::FILE* file, std::vector<std::unique_ptr<T>> &block_list, size_t link_index, size_t update_option);
 
   template<typename T>
-  void WriteBlock4(std::FILE* file, std::unique_ptr<T> &block, size_t link_index);
+  void WriteBlock4(std::FILE* file, T &block, size_t link_index); ///< Writes a block if not written.
+
+  /** \brief Reads a block that many blocks may reference.
+   *
+   * Blocks that reference the same file position share one block object.
+   * The block is only read by the first reference.
+   * @tparam T Block type.
+   * @param file File to read from.
+   * @param link_index Link index to the block.
+   * @return The shared block.
+   */
+  template<typename T>
+  std::shared_ptr<T> ReadSharedBlock4(std::streambuf& file, size_t link_index);
+
+  /// Returns the block shared at a file position or null.
+  template<typename T>
+  [[nodiscard]] std::shared_ptr<T> FindShared(int64_t position) const;
+
+  /// Shares a new block. Returns any block already shared at the position.
+  template<typename T>
+  std::shared_ptr<T> AddShared(const std::shared_ptr<T>& block);
 
+ private:
+  size_t ReadFixedHeader4(std::streambuf& file); ///< Reads the 24 byte MDF4 header.
+  size_t ReadLinks4(std::streambuf& buffer); ///< Decodes the MDF4 links.
+  void CheckBlockLength() const; ///< Throws if the links don't fit in the block length.
 };
 
 template<typename T>
-void IBlock::ReadLink4List(std::FILE *file, std::vector<std::unique_ptr<T>> &block_list, size_t link_index) {
+void IBlock::ReadLink4List(std::streambuf& file, std::vector<std::unique_ptr<T>> &block_list, size_t link_index) {
   if (block_list.empty() && (Link(link_index) > 0))
     for (auto link = Link(link_index); link > 0; /* No ++ here*/) {
       auto block = std::make_unique<T>();
@@ -246,7 +430,7 @@ void IBlock::ReadLink4List(std::FILE *file, std::vector<std::unique_ptr<T>> &blo
 }
 
 template<typename T>
-void IBlock::WriteBlock4(std::FILE *file, std::unique_ptr<T> &block, size_t link_index) {
+void IBlock::WriteBlock4(std::FILE *file, T &block, size_t link_index) {
   if (!block || block->FilePosition() > 0) {
     return;
   }
@@ -254,6 +438,42 @@ void IBlock::WriteBlock4(std::FILE *file, std::unique_ptr<T> &block, size_t link
   UpdateLink(file, link_index, block->FilePosition());
 }
 
+template<typename T>
+std::shared_ptr<T> IBlock::ReadSharedBlock4(std::streambuf& file, size_t link_index) {
+  const auto link = Link(link_index);
+  if (link <= 0) {
+    return {};
+  }
+  auto block = FindShared<T>(link);
+  if (block) {
+    return block;
+  }
+  auto* arena = BlockArena::Current();
+  block = arena != nullptr ? std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(arena))
+                           : std::make_shared<T>();
+  block->Init(*this);
+  SetFilePosition(file, link);
+  block->Read(file);
+  return AddShared(block);
+}
+
+template<typename T>
+std::shared_ptr<T> IBlock::FindShared(int64_t position) const {
+  if (block_index_ == nullptr) {
+    return {};
+  }
+  return std::dynamic_pointer_cast<T>(block_index_->FindShared(position));
+}
+
+template<typename T>
+std::shared_ptr<T> IBlock::AddShared(const std::shared_ptr<T>& block) {
+  if (block_index_ == nullptr) {
+    return block;
+  }
+  auto shared = std::dynamic_pointer_cast<T>(block_index_->AddShared(block));
+  return shared ? shared : block;
+}
+
 template<typename T>
 void IBlock::WriteLink4List(std::FILE *file,
                             std::vector<std::unique_ptr<T>> &block_list,
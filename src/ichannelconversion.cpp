@@ -33,6 +33,10 @@ void IChannelConversion::ChannelDataType(uint8_t channel_data_type) {
   channel_data_type_ = channel_data_type;
 }
 
+uint8_t IChannelConversion::ChannelDataType() const {
+  return channel_data_type_;
+}
+
 bool IChannelConversion::IsChannelInteger() const {
   return channel_data_type_ <= 3;
 }
@@ -28,6 +28,10 @@ size_t IChannelGroup::Sample() const {
   return sample_;
 }
 
+void IChannelGroup::Sample(size_t sample) const {
+  sample_ = sample;
+}
+
 uint16_t IChannelGroup::Flags() {
   return 0;
 }
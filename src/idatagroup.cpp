@@ -33,6 +33,20 @@ void IDataGroup::NotifySampleObservers(size_t sample, uint64_t record_id, const
   }
 }
 
+bool IDataGroup::IsRecordIdNeeded(uint64_t record_id) const {
+  return std::ranges::any_of(observer_list, [&](const auto* observer) {
+    return observer != nullptr && observer->IsRecordIdNeeded(record_id);
+  });
+}
+
+void IDataGroup::NotifySampleRange(size_t first_sample, size_t nof_samples) const {
+  for (auto* observer : observer_list) {
+    if (observer != nullptr) {
+      observer->OnSampleRange(first_sample, nof_samples);
+    }
+  }
+}
+
 void IDataGroup::ResetSample() const {
   std::ranges::for_each(ChannelGroups(), [](const auto *cg) {cg->ResetSample(); });
 }
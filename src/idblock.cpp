@@ -49,7 +49,7 @@ void IdBlock::GetBlockProperty(BlockPropertyList &dest) const {
 
 }
 
-size_t IdBlock::Read(std::FILE *file) {
+size_t IdBlock::Read(std::streambuf& file) {
   block_type_ = "ID";
   block_length_ = 64;
 
@@ -10,7 +10,7 @@ class IdBlock : public IBlock {
  public:
   IdBlock();
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
 
   [[nodiscard]] std::string FileId() const;
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace mdf::detail {
+
+/** \class IReadAhead ireadahead.h "ireadahead.h"
+ * \brief Interface for stream buffers that accept read-ahead hints.
+ *
+ * The hint tells the operating system that a file region will be read soon,
+ * so it can be fetched in the background. Hints are advisory only and
+ * may be ignored.
+ */
+class IReadAhead {
+ public:
+  virtual ~IReadAhead() = default;
+
+  /** \brief Hints that a file region will be read soon.
+   *
+   * @param offset File offset of the region.
+   * @param size Size of the region.
+   */
+  virtual void WillNeed(int64_t offset, size_t size) const = 0;
+};
+
+}  // namespace mdf::detail
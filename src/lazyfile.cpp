@@ -0,0 +1,36 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#include <ios>
+#include "lazyfile.h"
+
+namespace mdf::detail {
+
+LazyFile::LazyFile(FileOpener opener, bool keep_open, BlockArena* arena)
+    : opener_(std::move(opener)),
+      keep_open_(keep_open),
+      arena_(arena) {
+}
+
+void LazyFile::Read(const std::function<void(std::streambuf&)>& read) const {
+  std::lock_guard lock(locker_);
+  if (!file_ && opener_) {
+    file_ = opener_();
+  }
+  if (!file_) {
+    throw std::ios_base::failure("Failed to open the file");
+  }
+  try {
+    BlockArena::Scope arena_scope(arena_);
+    read(*file_);
+  } catch (...) {
+    file_.reset();
+    throw;
+  }
+  if (!keep_open_) {
+    file_.reset();
+  }
+}
+
+}  // namespace mdf::detail
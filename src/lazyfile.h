@@ -0,0 +1,48 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include "blockarena.h"
+#include "iblock.h"
+
+namespace mdf::detail {
+
+/** \class LazyFile lazyfile.h "lazyfile.h"
+ * \brief Gives access to the MDF file for blocks that are read on demand.
+ *
+ * The channel groups and channels use this object to read their child
+ * blocks the first time they are accessed. The file is opened by a
+ * function supplied by the reader. The reads are serialized, so blocks in
+ * different threads may load at the same time. The object is owned by the
+ * MDF file object.
+ */
+class LazyFile {
+ public:
+  /** \brief Constructor.
+   *
+   * @param opener Function that opens the file. Returns null on failure.
+   * @param keep_open If true, the file is kept open between the reads.
+   * @param arena Arena for the blocks read on demand. Null means heap.
+   */
+  LazyFile(FileOpener opener, bool keep_open, BlockArena* arena = nullptr);
+
+  /** \brief Calls a read function with an open file.
+   *
+   * Throws an exception if the file cannot be opened.
+   * @param read Function that reads blocks from the file.
+   */
+  void Read(const std::function<void(std::streambuf&)>& read) const;
+ private:
+  FileOpener opener_;
+  bool keep_open_ = true;
+  BlockArena* arena_ = nullptr;
+  mutable std::mutex locker_;
+  mutable std::unique_ptr<std::streambuf> file_; ///< Open file if kept open.
+};
+
+}  // namespace mdf::detail
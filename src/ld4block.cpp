@@ -63,38 +63,39 @@ void Ld4Block::GetBlockProperty(BlockPropertyList &dest) const {
   }
 }
 
-size_t Ld4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, flags_);
-  bytes += ReadNumber(file, nof_blocks_);
+size_t Ld4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, flags_);
+  bytes += ReadNumber(data, nof_blocks_);
 
   if (flags_ & Ld4Flags::EqualSampleCount) {
-    bytes += ReadNumber(file, equal_sample_count_);
+    bytes += ReadNumber(data, equal_sample_count_);
   } else {
     for (uint32_t ii = 0; ii < nof_blocks_; ++ii) {
       uint64_t offset = 0;
-      bytes += ReadNumber(file, offset);
+      bytes += ReadNumber(data, offset);
       offset_list_.push_back(offset);
     }
   }
   if (flags_ & Ld4Flags::TimeValues) {
     for (uint32_t ii = 0; ii < nof_blocks_; ++ii) {
       int64_t value = 0;
-      bytes += ReadNumber(file, value);
+      bytes += ReadNumber(data, value);
       time_values_.push_back(value);
     }
   }
   if (flags_ & Ld4Flags::AngleValues) {
     for (uint32_t ii = 0; ii < nof_blocks_; ++ii) {
       int64_t value = 0;
-      bytes += ReadNumber(file, value);
+      bytes += ReadNumber(data, value);
       angle_values_.push_back(value);
     }
   }
   if (flags_ & Ld4Flags::DistanceValues) {
     for (uint32_t ii = 0; ii < nof_blocks_; ++ii) {
       int64_t value = 0;
-      bytes += ReadNumber(file, value);
+      bytes += ReadNumber(data, value);
       distance_values_.push_back(value);
     }
   }
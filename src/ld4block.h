@@ -19,13 +19,12 @@ constexpr uint32_t InvalidData = 0x80000000;
 class Ld4Block : public DataListBlock {
  public:
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
  private:
   uint32_t flags_ = 0;
   uint32_t nof_blocks_ = 0;
   uint64_t equal_sample_count_ = 0;
   std::vector<uint64_t> offset_list_;
-  std::vector<int64_t> time_values_;     // Note that this actually store an int64_t or a double.
   std::vector<int64_t> angle_values_;    // Note that this actually store an int64_t or a double.
   std::vector<int64_t> distance_values_; // Note that this actually store an int64_t or a double.
 };
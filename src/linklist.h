@@ -0,0 +1,101 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace mdf::detail {
+
+/** \class LinkList linklist.h "linklist.h"
+ * \brief List of block links with in place storage.
+ *
+ * Most blocks have a few links. A channel block has 8 links unless it
+ * references attachments. These links are stored in the object itself, so
+ * the block needs no extra heap allocation. Longer lists, as the links of a
+ * CC block with many references, are stored on the heap.
+ *
+ * The interface is the subset of std::vector that the blocks use.
+ */
+class LinkList {
+ public:
+  static constexpr size_t kInlineSize = 8;
+
+  LinkList() = default;
+  LinkList(const LinkList& list) {
+    *this = list;
+  }
+  LinkList& operator=(const LinkList& list) {
+    if (this != &list) {
+      resize(list.size_);
+      std::copy_n(list.data(), list.size_, data());
+    }
+    return *this;
+  }
+  ~LinkList() {
+    if (IsHeap()) {
+      delete [] heap_;
+    }
+  }
+
+  [[nodiscard]] size_t size() const { return size_; }
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+
+  int64_t& operator[](size_t index) { return data()[index]; }
+  int64_t operator[](size_t index) const { return data()[index]; }
+
+  [[nodiscard]] int64_t* begin() { return data(); }
+  [[nodiscard]] int64_t* end() { return data() + size_; }
+  [[nodiscard]] const int64_t* begin() const { return data(); }
+  [[nodiscard]] const int64_t* end() const { return data() + size_; }
+
+  void clear() { size_ = 0; }
+
+  void reserve(size_t capacity) {
+    if (capacity <= Capacity()) {
+      return;
+    }
+    auto* heap = new int64_t[capacity];
+    std::copy_n(data(), size_, heap);
+    if (IsHeap()) {
+      delete [] heap_;
+    }
+    heap_ = heap;
+    capacity_ = static_cast<uint32_t>(capacity);
+  }
+
+  void resize(size_t size, int64_t value = 0) {
+    reserve(size);
+    if (size > size_) {
+      std::fill(data() + size_, data() + size, value);
+    }
+    size_ = static_cast<uint32_t>(size);
+  }
+
+  void emplace_back(int64_t link) {
+    if (size_ >= Capacity()) {
+      reserve(std::max<size_t>(size_ * 2, kInlineSize * 2));
+    }
+    data()[size_++] = link;
+  }
+ private:
+  union {
+    int64_t inline_[kInlineSize] = {};
+    int64_t* heap_; ///< Used if the list doesn't fit in place.
+  };
+  uint32_t size_ = 0;
+  uint32_t capacity_ = kInlineSize;
+
+  [[nodiscard]] bool IsHeap() const { return capacity_ > kInlineSize; }
+  [[nodiscard]] size_t Capacity() const { return capacity_; }
+  [[nodiscard]] int64_t* data() {
+    return IsHeap() ? heap_ : inline_;
+  }
+  [[nodiscard]] const int64_t* data() const {
+    return IsHeap() ? heap_ : inline_;
+  }
+};
+
+}  // namespace mdf::detail
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#include <algorithm>
+#ifdef WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // std::min and std::max
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfilebuffer.h"
+
+namespace mdf::detail {
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+bool MappedFile::IsOpen() const {
+  return open_;
+}
+
+const uint8_t *MappedFile::Data() const {
+  return static_cast<const uint8_t*>(view_);
+}
+
+size_t MappedFile::Size() const {
+  return view_size_;
+}
+
+#ifdef WIN32
+bool MappedFile::Open(const std::string &filename) {
+  Close();
+  auto file = CreateFileA(filename.c_str(), GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                          OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER size {};
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+  file_handle_ = file;
+  open_ = true;
+  if (size.QuadPart == 0) {
+    // An empty file cannot be mapped
+    return true;
+  }
+
+  map_handle_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (map_handle_ == nullptr) {
+    Close();
+    return false;
+  }
+  view_ = MapViewOfFile(map_handle_, FILE_MAP_READ, 0, 0, 0);
+  if (view_ == nullptr) {
+    Close();
+    return false;
+  }
+  view_size_ = static_cast<size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (view_ != nullptr) {
+    UnmapViewOfFile(view_);
+    view_ = nullptr;
+  }
+  view_size_ = 0;
+  if (map_handle_ != nullptr) {
+    CloseHandle(map_handle_);
+    map_handle_ = nullptr;
+  }
+  if (file_handle_ != nullptr) {
+    CloseHandle(file_handle_);
+    file_handle_ = nullptr;
+  }
+  open_ = false;
+}
+
+void MappedFile::WillNeed(size_t offset, size_t size) const {
+#if (_WIN32_WINNT >= 0x0602)
+  if (view_ == nullptr || offset >= view_size_) {
+    return;
+  }
+  WIN32_MEMORY_RANGE_ENTRY range {};
+  range.VirtualAddress = static_cast<uint8_t*>(view_) + offset;
+  range.NumberOfBytes = std::min(size, view_size_ - offset);
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+}
+
+#else
+bool MappedFile::Open(const std::string &filename) {
+  Close();
+  const int file = ::open(filename.c_str(), O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+  struct stat info {};
+  if (::fstat(file, &info) != 0) {
+    ::close(file);
+    return false;
+  }
+  file_handle_ = file;
+  open_ = true;
+  if (info.st_size == 0) {
+    // An empty file cannot be mapped
+    return true;
+  }
+
+  view_size_ = static_cast<size_t>(info.st_size);
+  view_ = ::mmap(nullptr, view_size_, PROT_READ, MAP_SHARED, file, 0);
+  if (view_ == MAP_FAILED) {
+    view_ = nullptr;
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::Close() {
+  if (view_ != nullptr) {
+    ::munmap(view_, view_size_);
+    view_ = nullptr;
+  }
+  view_size_ = 0;
+  if (file_handle_ >= 0) {
+    ::close(file_handle_);
+    file_handle_ = -1;
+  }
+  open_ = false;
+}
+
+void MappedFile::WillNeed(size_t offset, size_t size) const {
+  if (view_ == nullptr || offset >= view_size_) {
+    return;
+  }
+  // The address must be page aligned
+  static const auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  const auto start = offset - (offset % page_size);
+  const auto length = std::min(offset + size, view_size_) - start;
+  ::madvise(static_cast<uint8_t*>(view_) + start, length, MADV_WILLNEED);
+}
+#endif
+
+MappedFileBuffer::MappedFileBuffer(std::shared_ptr<MappedFile> file)
+    : file_(std::move(file)) {
+  if (file_ && file_->IsOpen()) {
+    Attach(file_->Data(), file_->Size());
+  }
+}
+
+const std::shared_ptr<MappedFile> &MappedFileBuffer::File() const {
+  return file_;
+}
+
+void MappedFileBuffer::WillNeed(int64_t offset, size_t size) const {
+  if (file_ && offset >= 0) {
+    file_->WillNeed(static_cast<size_t>(offset), size);
+  }
+}
+
+}  // namespace mdf::detail
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <memory>
+#include <string>
+#include "ireadahead.h"
+#include "memorybuffer.h"
+
+namespace mdf::detail {
+
+/** \class MappedFile mappedfilebuffer.h "mappedfilebuffer.h"
+ * \brief Read-only file that is memory mapped.
+ *
+ * The whole file is mapped into memory when opened. The mapping may be shared
+ * by many stream buffers, see MappedFileBuffer.
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::string& filename); ///< Maps the file into memory.
+  void Close(); ///< Unmaps the file.
+  [[nodiscard]] bool IsOpen() const; ///< Returns true if the file is mapped.
+  [[nodiscard]] const uint8_t* Data() const; ///< Start of the mapped file.
+  [[nodiscard]] size_t Size() const; ///< Size of the mapped file.
+  void WillNeed(size_t offset, size_t size) const; ///< Hints that the pages will be read soon.
+ private:
+#ifdef WIN32
+  void* file_handle_ = nullptr; ///< Windows file handle.
+  void* map_handle_ = nullptr; ///< Windows file mapping handle.
+#else
+  int file_handle_ = -1; ///< File descriptor.
+#endif
+  void* view_ = nullptr; ///< Start of the mapped view.
+  size_t view_size_ = 0; ///< Size of the mapped view.
+  bool open_ = false; ///< True if the file is open.
+};
+
+/** \class MappedFileBuffer mappedfilebuffer.h "mappedfilebuffer.h"
+ * \brief Read-only stream buffer over a memory mapped file.
+ *
+ * Reading a block is a plain memory copy and seeking is a pointer update,
+ * which avoid the system calls that a normal file stream does for each block.
+ * Each buffer have its own read position, so many buffers may share one
+ * mapping.
+ */
+class MappedFileBuffer : public MemoryBuffer, public IReadAhead {
+ public:
+  explicit MappedFileBuffer(std::shared_ptr<MappedFile> file);
+  ~MappedFileBuffer() override = default;
+
+  [[nodiscard]] const std::shared_ptr<MappedFile>& File() const; ///< Shared mapping.
+  void WillNeed(int64_t offset, size_t size) const override;
+ private:
+  std::shared_ptr<MappedFile> file_;
+};
+
+}  // namespace mdf::detail
@@ -18,11 +18,15 @@ Mdf3File::Mdf3File()
   hd_block_(std::make_unique<Hd3Block>())
 {
   id_block_->SetDefaultMdf3Values();
+  id_block_->SetBlockIndex(&block_index_);
   hd_block_->Init(*id_block_);
 }
 
 Mdf3File::Mdf3File(std::unique_ptr<IdBlock> id_block)
     : id_block_(std::move(id_block)) {
+  if (id_block_) {
+    id_block_->SetBlockIndex(&block_index_);
+  }
 }
 
 void Mdf3File::Attachments(AttachmentList &dest) const {
@@ -42,9 +46,10 @@ IHeader *Mdf3File::Header() const {
   return hd_block_.get();
 }
 
-void Mdf3File::ReadHeader(std::FILE *file) {
+void Mdf3File::ReadHeader(std::streambuf& file) {
   if (!id_block_) {
     id_block_ = std::make_unique<IdBlock>();
+    id_block_->SetBlockIndex(&block_index_);
   }
   if (id_block_->FilePosition() < 0) {
     SetFilePosition(file, 0);
@@ -62,13 +67,13 @@ void Mdf3File::ReadHeader(std::FILE *file) {
 
 }
 
-void Mdf3File::ReadMeasurementInfo(std::FILE *file) {
+void Mdf3File::ReadMeasurementInfo(std::streambuf& file) {
   ReadHeader(file);
   if (hd_block_) {
     hd_block_->ReadMeasurementInfo(file);
   }
 }
-void Mdf3File::ReadEverythingButData(std::FILE *file) {
+void Mdf3File::ReadEverythingButData(std::streambuf& file) {
   ReadHeader(file);
   if (hd_block_) {
     hd_block_->ReadMeasurementInfo(file);
@@ -94,6 +99,9 @@ const Hd3Block &Mdf3File::Hd() const {
 }
 
 const IBlock *Mdf3File::Find(fpos_t id) const {
+  if (const auto* block = block_index_.Find(id); block != nullptr) {
+    return block;
+  }
   if (id_block_) {
     const auto* p = id_block_->Find(id);
     if (p != nullptr) {
@@ -7,6 +7,7 @@
 #include "mdf/idatagroup.h"
 #include "mdf/mdffile.h"
 #include "idblock.h"
+#include "blockindex.h"
 #include "hd3block.h"
 
 namespace mdf::detail {
@@ -36,9 +37,9 @@ class Mdf3File : public MdfFile {
                    uint16_t standard_flags, uint16_t custom_flags) override;
   [[nodiscard]] bool IsFinalized(uint16_t& standard_flags, uint16_t& custom_flags) const override;
 
-  void ReadHeader(std::FILE *file) override;
-  void ReadMeasurementInfo(std::FILE *file) override;
-  void ReadEverythingButData(std::FILE *file) override;
+  void ReadHeader(std::streambuf& file) override;
+  void ReadMeasurementInfo(std::streambuf& file) override;
+  void ReadEverythingButData(std::streambuf& file) override;
 
   [[nodiscard]] const IdBlock &Id() const;
   [[nodiscard]] const Hd3Block &Hd() const;
@@ -50,6 +51,7 @@ class Mdf3File : public MdfFile {
   Mdf3File &operator=(const Mdf3File &) = delete;
   Mdf3File &operator=(Mdf3File &&) = delete;
  private:
+  BlockIndex block_index_; ///< Must be destroyed after the blocks.
   std::unique_ptr<IdBlock> id_block_;
   std::unique_ptr<Hd3Block> hd_block_;
 };
@@ -13,20 +13,25 @@ Mdf4File::Mdf4File()
     : id_block_(std::make_unique<IdBlock>()),
       hd_block_(std::make_unique<Hd4Block>())
 {
+  id_block_->SetBlockIndex(&block_index_);
   hd_block_->Init(*id_block_);
 }
 
 Mdf4File::Mdf4File(std::unique_ptr<IdBlock> id_block)
     : id_block_(std::move(id_block)) {
+  if (id_block_) {
+    id_block_->SetBlockIndex(&block_index_);
+  }
 }
 
 IHeader *Mdf4File::Header() const {
   return hd_block_.get();
 }
 
-void Mdf4File::ReadHeader(std::FILE *file) {
+void Mdf4File::ReadHeader(std::streambuf& file) {
   if (!id_block_) {
     id_block_ = std::make_unique<IdBlock>();
+    id_block_->SetBlockIndex(&block_index_);
     SetFilePosition(file, 0);
     id_block_->Read(file);
   }
@@ -39,18 +44,18 @@ void Mdf4File::ReadHeader(std::FILE *file) {
 
 }
 
-void Mdf4File::ReadMeasurementInfo(std::FILE *file) {
+void Mdf4File::ReadMeasurementInfo(std::streambuf& file) {
   ReadHeader(file);
   if (hd_block_) {
     hd_block_->ReadMeasurementInfo(file);
   }
 }
 
-void Mdf4File::ReadEverythingButData(std::FILE *file) {
+void Mdf4File::ReadEverythingButData(std::streambuf& file) {
   ReadHeader(file);
   if (hd_block_) {
     hd_block_->ReadMeasurementInfo(file);
-    hd_block_->ReadEverythingButData(file);
+    hd_block_->ReadEverythingButData(file, lazy_file_.get(), &parallel_);
   }
 
 }
@@ -66,6 +71,14 @@ const IdBlock &Mdf4File::Id() const {
   return *id_block_;
 }
 
+void Mdf4File::SetLazyFile(std::unique_ptr<LazyFile> lazy_file) {
+  lazy_file_ = std::move(lazy_file);
+}
+
+void Mdf4File::SetParallelRead(const ParallelRead& parallel) {
+  parallel_ = parallel;
+}
+
 const Hd4Block &Mdf4File::Hd() const {
   if (!hd_block_) {
     throw std::domain_error("HD4 block not initialized yet");
@@ -74,6 +87,9 @@ const Hd4Block &Mdf4File::Hd() const {
 }
 
 const IBlock *Mdf4File::Find(fpos_t id) const {
+  if (const auto* block = block_index_.Find(id); block != nullptr) {
+    return block;
+  }
   if (id_block_) {
     const auto* p = id_block_->Find(id);
     if (p != nullptr) {
@@ -7,6 +7,8 @@
 #include <memory>
 #include "mdf/mdffile.h"
 #include "idblock.h"
+#include "blockindex.h"
+#include "lazyfile.h"
 #include "hd4block.h"
 
 namespace mdf::detail {
@@ -44,16 +46,33 @@ class Mdf4File : public MdfFile {
                    uint16_t standard_flags, uint16_t custom_flags) override;
   [[nodiscard]] bool IsFinalized(uint16_t& standard_flags, uint16_t& custom_flags) const override;
 
-  void ReadHeader(std::FILE *file) override;
-  void ReadMeasurementInfo(std::FILE *file) override;
-  void ReadEverythingButData(std::FILE *file) override;
+  void ReadHeader(std::streambuf& file) override;
+  void ReadMeasurementInfo(std::streambuf& file) override;
+  void ReadEverythingButData(std::streambuf& file) override;
 
   [[nodiscard]] const IdBlock &Id() const;
   [[nodiscard]] const Hd4Block &Hd() const;
 
+  /** \brief Reads the channel blocks on demand.
+   *
+   * When set, ReadEverythingButData() doesn't read the channel lists. The
+   * lists are read through the lazy file when they are first accessed.
+   * @param lazy_file File access for the deferred reads.
+   */
+  void SetLazyFile(std::unique_ptr<LazyFile> lazy_file);
+
+  /** \brief Reads the channel blocks of the data groups in parallel.
+   *
+   * @param parallel Number of threads and a file opener for the threads.
+   */
+  void SetParallelRead(const ParallelRead& parallel);
+
   bool Write(std::FILE* file) override;
 
  private:
+  BlockIndex block_index_; ///< Must be destroyed after the blocks.
+  std::unique_ptr<LazyFile> lazy_file_; ///< Must be destroyed after the blocks.
+  ParallelRead parallel_;
   std::unique_ptr<IdBlock> id_block_;
   std::unique_ptr<Hd4Block> hd_block_;
 };
@@ -36,7 +36,7 @@ void Mdf4Timestamp::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Time Flags", flags.str() );
 }
 
-size_t Mdf4Timestamp::Read(std::FILE *file) {
+size_t Mdf4Timestamp::Read(std::streambuf& file) {
   file_position_ = GetFilePosition(file);
   size_t bytes = ReadNumber(file, time_);
   bytes += ReadNumber(file, tz_offset_);
@@ -18,7 +18,7 @@ constexpr uint8_t kTimeOffsetValid = 0x02;
 class Mdf4Timestamp : public IBlock {
  public:
   void GetBlockProperty(BlockPropertyList &dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
 
   [[nodiscard]] uint64_t NsSince1970() const;
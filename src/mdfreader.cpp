@@ -2,12 +2,15 @@
  * Copyright 2021 Ingemar Hedvall
  * SPDX-License-Identifier: MIT
  */
+#include <algorithm>
 #include <cstdio>
+#include <fstream>
 #include <string>
 #include <filesystem>
 #include <thread>
 #include <chrono>
 #include <vector>
+#include <limits>
 
 #include "util/stringutil.h"
 #include "util/logstream.h"
@@ -18,17 +21,25 @@
 #include "mdf3file.h"
 #include "mdf4file.h"
 #include "channelobserver.h"
+#include "mappedfilebuffer.h"
+#include "positionalfile.h"
+#include "sharedfilecache.h"
+#include "blockarena.h"
 
 
 using namespace util::log;
 using namespace util::string;
 using namespace std::chrono_literals;
 
+namespace {
+constexpr uint16_t kUpdateLastDt = 0x04; ///< Unfinished flag. The last DT block length isn't updated.
+}
+
 namespace mdf {
 
 bool IsMdfFile(const std::string &filename) {
-  auto *file = std::fopen(filename.c_str(), "rb");
-  if (file == nullptr) {
+  std::filebuf file;
+  if (file.open(filename, std::ios_base::in | std::ios_base::binary) == nullptr) {
     return false;
   }
 
@@ -42,7 +53,7 @@ bool IsMdfFile(const std::string &filename) {
   } catch (const std::exception &) {
     bError = true;
   }
-  std::fclose(file);
+  file.close();
   if (bError) {
     return false;
   }
@@ -174,8 +185,13 @@ void CreateChannelObserverForChannelGroup(const IDataGroup &data_group,
 
 
 
-MdfReader::MdfReader(const std::string &filename)
-    : filename_(filename) {
+MdfReader::MdfReader(const std::string &filename, ReadBackend backend)
+    : MdfReader(filename, MdfReaderOptions{backend}) {
+}
+
+MdfReader::MdfReader(const std::string &filename, const MdfReaderOptions& options)
+    : filename_(filename),
+      options_(options) {
   // Need to create MDF3 of MDF4 file
   bool bExist = false;
   try {
@@ -201,8 +217,33 @@ MdfReader::MdfReader(const std::string &filename)
     return;
 
   }
+  CreateInstance();
+}
+
+MdfReader::MdfReader(std::span<const uint8_t> buffer, const MdfReaderOptions& options)
+    : options_(options),
+      buffer_(buffer) {
+  options_.backend = ReadBackend::Memory;
+  if (!Open() || file_ == nullptr) {
+    LOG_ERROR() << "The memory buffer is empty.";
+    return;
+  }
+  CreateInstance();
+}
+
+void MdfReader::CreateInstance() {
+  if (options_.block_arena) {
+    arena_ = std::make_unique<detail::BlockArena>();
+  }
+  detail::BlockArena::Scope arena_scope(arena_.get());
   std::unique_ptr<detail::IdBlock> id_block = std::make_unique<detail::IdBlock>();
-  id_block->Read(file_);
+  try {
+    id_block->Read(*file_);
+  } catch (const std::exception& error) {
+    LOG_ERROR() << "Failed to read the ID block. File: " << filename_ << ", Error: " << error.what();
+    Close();
+    return;
+  }
   if (util::string::IEquals(id_block->FileId(), "MDF", 3) ||
       util::string::IEquals(id_block->FileId(), "UnFinMF", 7)) {
     if (id_block->Version() >= 400) {
@@ -220,6 +261,9 @@ MdfReader::MdfReader(const std::string &filename)
     LOG_ERROR() << "This is not and MDF file. File: " << filename_;
     Close();
   }
+  if (options_.handle_policy == FileHandlePolicy::OpenPerCall) {
+    Close();
+  }
 }
 
 MdfReader::~MdfReader() {
@@ -236,14 +280,74 @@ std::string MdfReader::ShortName() const {
 }
 
 bool MdfReader::Open() {
-  return detail::OpenMdfFile(file_,filename_, "rb");
+  Close();
+  const bool shared = options_.handle_policy == FileHandlePolicy::SharedCache;
+  switch (options_.backend) {
+    case ReadBackend::MemoryMapped: {
+      auto& cache = detail::SharedFileCache<detail::MappedFile>::Instance();
+      auto mapped = shared ? cache.Find(filename_) : std::shared_ptr<detail::MappedFile>();
+      if (!mapped) {
+        mapped = std::make_shared<detail::MappedFile>();
+        if (!detail::OpenWithLockWait(filename_, [&] { return mapped->Open(filename_); },
+                                      options_.lock_wait, options_.lock_timeout)) {
+          return false;
+        }
+        if (shared) {
+          cache.Add(filename_, mapped);
+        }
+      }
+      file_ = std::make_unique<detail::MappedFileBuffer>(mapped);
+      break;
+    }
+
+    case ReadBackend::Memory:
+      if (buffer_.empty()) {
+        return false;
+      }
+      file_ = std::make_unique<detail::MemoryBuffer>(buffer_.data(), buffer_.size());
+      break;
+
+    case ReadBackend::Positional: {
+      auto& cache = detail::SharedFileCache<detail::PositionalFile>::Instance();
+      auto positional = shared ? cache.Find(filename_) : std::shared_ptr<detail::PositionalFile>();
+      if (!positional) {
+        positional = std::make_shared<detail::PositionalFile>();
+        if (!detail::OpenWithLockWait(filename_, [&] { return positional->Open(filename_); },
+                                      options_.lock_wait, options_.lock_timeout)) {
+          return false;
+        }
+        if (shared) {
+          cache.Add(filename_, positional);
+        }
+      }
+      file_ = std::make_unique<detail::PositionalFileBuffer>(positional);
+      break;
+    }
+
+    default: {
+      auto buffer = std::make_unique<std::filebuf>();
+      if (!detail::OpenMdfFile(*buffer, filename_,
+                               std::ios_base::in | std::ios_base::binary,
+                               options_.lock_wait, options_.lock_timeout)) {
+        return false;
+      }
+      file_ = std::move(buffer);
+      break;
+    }
+  }
+  return true;
 }
 
-void MdfReader::Close() {
-  if (file_ != nullptr) {
-    fclose(file_);
-    file_ = nullptr;
+bool MdfReader::OpenForCall() {
+  if (file_ != nullptr || !Open()) {
+    return false;
   }
+  return options_.handle_policy == FileHandlePolicy::OpenPerCall;
+}
+
+void MdfReader::Close() {
+  file_.reset();
+  follow_file_.reset();
 }
 
 bool MdfReader::ReadHeader() {
@@ -251,19 +355,17 @@ bool MdfReader::ReadHeader() {
     LOG_ERROR() << "No instance created. File: " << filename_;
     return false;
   }
-    // If file is not open then open and close the file in this call
-  bool shall_close = file_ == nullptr && Open();
-  if (file_ == nullptr) {
-    LOG_ERROR() << "File is not open. File: " << filename_;
-    return false;
-  }
+  // If file is not open then open and, depending on the handle policy,
+  // close the file in this call
+  const bool shall_close = OpenForCall();
   if (file_ == nullptr) {
     LOG_ERROR() << "File is not open. File: " << filename_;
     return false;
   }
   bool no_error = true;
   try {
-    instance_->ReadHeader(file_);
+    detail::BlockArena::Scope arena_scope(arena_.get());
+    instance_->ReadHeader(*file_);
   } catch (const std::exception &error) {
     LOG_ERROR() << "Initialization failed. Error: " << error.what();
     no_error = false;
@@ -279,14 +381,15 @@ bool MdfReader::ReadMeasurementInfo() {
     LOG_ERROR() << "No instance created. File: " << filename_;
     return false;
   }
-  bool shall_close = file_ == nullptr && Open();
+  const bool shall_close = OpenForCall();
   if (file_ == nullptr) {
     LOG_ERROR() << "File is not open. File: " << filename_;
     return false;
   }
   bool no_error = true;
   try {
-    instance_->ReadMeasurementInfo(file_);
+    detail::BlockArena::Scope arena_scope(arena_.get());
+    instance_->ReadMeasurementInfo(*file_);
 
   } catch (const std::exception &error) {
     LOG_ERROR() << "Failed to read the DG/CG blocks. Error: " << error.what();
@@ -303,14 +406,22 @@ bool MdfReader::ReadEverythingButData() {
     LOG_ERROR() << "No instance created. File: " << filename_;
     return false;
   }
-  bool shall_close = file_ == nullptr && Open();
+  const bool shall_close = OpenForCall();
   if (file_ == nullptr) {
     LOG_ERROR() << "File is not open. File: " << filename_;
     return false;
   }
   bool no_error = true;
   try {
-    instance_->ReadEverythingButData(file_);
+    detail::BlockArena::Scope arena_scope(arena_.get());
+    if (options_.lazy_channels) {
+      CreateLazyFile();
+    }
+    if (auto* mdf4 = dynamic_cast<detail::Mdf4File*>(instance_.get());
+        mdf4 != nullptr && options_.parse_threads > 1) {
+      mdf4->SetParallelRead({options_.parse_threads, MakeFileOpener()});
+    }
+    instance_->ReadEverythingButData(*file_);
 
   } catch (const std::exception &error) {
     LOG_ERROR() << "Failed to read the file information blocks. Error: " << error.what();
@@ -322,13 +433,42 @@ bool MdfReader::ReadEverythingButData() {
   return no_error;
 }
 
+std::function<std::unique_ptr<std::streambuf>()> MdfReader::MakeFileOpener() const {
+  // Use a private file position if the backend supports it. Otherwise the
+  // file is opened as a file stream.
+  return [this] () -> std::unique_ptr<std::streambuf> {
+    auto cursor = CreateCursor();
+    if (cursor) {
+      return cursor;
+    }
+    auto buffer = std::make_unique<std::filebuf>();
+    if (filename_.empty() ||
+        !detail::OpenMdfFile(*buffer, filename_,
+                             std::ios_base::in | std::ios_base::binary,
+                             options_.lock_wait, options_.lock_timeout)) {
+      return {};
+    }
+    return buffer;
+  };
+}
+
+void MdfReader::CreateLazyFile() {
+  auto* mdf4 = dynamic_cast<detail::Mdf4File*>(instance_.get());
+  if (mdf4 == nullptr) {
+    return; // Only MDF4 files support on demand reading
+  }
+  const bool keep_open = options_.handle_policy != FileHandlePolicy::OpenPerCall;
+  mdf4->SetLazyFile(std::make_unique<detail::LazyFile>(MakeFileOpener(), keep_open,
+                                                       arena_.get()));
+}
+
 bool MdfReader::ExportAttachmentData(const IAttachment &attachment, const std::string &dest_file) {
   if (!instance_) {
     LOG_ERROR() << "No instance created. File: " << filename_;
     return false;
   }
 
-  bool shall_close = file_ == nullptr && Open();
+  const bool shall_close = OpenForCall();
   if (file_ == nullptr) {
     LOG_ERROR() << "Failed to open file. File: " << filename_;
     return false;
@@ -337,7 +477,7 @@ bool MdfReader::ExportAttachmentData(const IAttachment &attachment, const std::s
   bool no_error = true;
   try {
     auto& at4 = dynamic_cast<const detail::At4Block&>(attachment);
-    at4.ReadData(file_, dest_file);
+    at4.ReadData(*file_, dest_file);
   } catch (const std::exception &error) {
     LOG_ERROR() << "Failed to read the file information blocks. Error: " << error.what();
     no_error = false;
@@ -350,31 +490,78 @@ bool MdfReader::ExportAttachmentData(const IAttachment &attachment, const std::s
 }
 
 bool MdfReader::ReadData(const IDataGroup &data_group) {
+  return ReadData(data_group, 0, std::numeric_limits<size_t>::max());
+}
+
+bool MdfReader::ReadData(const IDataGroup &data_group, size_t first_sample, size_t nof_samples) {
   if (!instance_) {
     LOG_ERROR() << "No instance created. File: " << filename_;
     return false;
   }
 
-  bool shall_close = file_ == nullptr && Open();
+  // The memory mapped and positional backends may read through a private
+  // file position. This doesn't touch the reader and is thread-safe.
+  auto cursor = CreateCursor();
+  if (cursor) {
+    return ReadData(data_group, *cursor, first_sample, nof_samples);
+  }
+
+  const bool shall_close = OpenForCall();
   if (file_ == nullptr) {
     LOG_ERROR() << "Failed to open file. File: " << filename_;
     return false;
   }
 
+  const bool no_error = ReadData(data_group, *file_, first_sample, nof_samples);
+
+  if (shall_close) {
+    Close();
+  }
+  return no_error;
+}
+
+bool MdfReader::ReadData(const IDataGroup &data_group, std::streambuf& file,
+                         size_t first_sample, size_t nof_samples) const {
   bool no_error = true;
   try {
+    data_group.NotifySampleRange(first_sample, nof_samples);
     if (instance_->IsMdf4()) {
       const auto& dg4 = dynamic_cast<const detail::Dg4Block&>(data_group);
-      dg4.ReadData(file_);
+      dg4.ReadData(file, first_sample, nof_samples, options_.inflate_threads);
     } else {
       const auto& dg3 = dynamic_cast<const detail::Dg3Block&>(data_group);
-      dg3.ReadData(file_);
+      dg3.ReadData(file, first_sample, nof_samples);
 
     }
   } catch (const std::exception &error) {
     LOG_ERROR() << "Failed to read the file information blocks. Error: " << error.what();
     no_error = false;
   }
+  return no_error;
+}
+
+bool MdfReader::ReadTimeRange(const IDataGroup &data_group, double start_time, double end_time) {
+  if (!instance_) {
+    LOG_ERROR() << "No instance created. File: " << filename_;
+    return false;
+  }
+  if (!instance_->IsMdf4()) {
+    LOG_ERROR() << "Time range reads require an MDF4 file. File: " << filename_;
+    return false;
+  }
+
+  auto cursor = CreateCursor();
+  if (cursor) {
+    return ReadTimeRange(data_group, *cursor, start_time, end_time);
+  }
+
+  const bool shall_close = OpenForCall();
+  if (file_ == nullptr) {
+    LOG_ERROR() << "Failed to open file. File: " << filename_;
+    return false;
+  }
+
+  const bool no_error = ReadTimeRange(data_group, *file_, start_time, end_time);
 
   if (shall_close) {
     Close();
@@ -382,6 +569,129 @@ bool MdfReader::ReadData(const IDataGroup &data_group) {
   return no_error;
 }
 
+bool MdfReader::ReadTimeRange(const IDataGroup &data_group, std::streambuf& file,
+                              double start_time, double end_time) const {
+  size_t first_sample = 0;
+  size_t nof_samples = 0;
+  try {
+    const auto& dg4 = dynamic_cast<const detail::Dg4Block&>(data_group);
+    if (!dg4.FindSampleRange(file, start_time, end_time, first_sample, nof_samples)) {
+      LOG_ERROR() << "Time range reads require a sorted data group with a master channel. File: "
+                  << filename_;
+      return false;
+    }
+  } catch (const std::exception &error) {
+    LOG_ERROR() << "Failed to find the time range. Error: " << error.what();
+    return false;
+  }
+  return ReadData(data_group, file, first_sample, nof_samples);
+}
+
+bool MdfReader::ReadNewData(const IDataGroup &data_group) {
+  if (!instance_) {
+    LOG_ERROR() << "No instance created. File: " << filename_;
+    return false;
+  }
+  if (!instance_->IsMdf4()) {
+    LOG_ERROR() << "Follow mode requires an MDF4 file. File: " << filename_;
+    return false;
+  }
+
+  // The file is kept open between the calls unless the policy is OpenPerCall.
+  // A memory mapping keeps the size of the file when it was mapped, so the
+  // appended bytes of a mapped file are read through a file stream instead.
+  bool shall_close = false;
+  std::unique_ptr<std::streambuf> cursor;
+  std::streambuf* file = nullptr;
+  switch (options_.backend) {
+    case ReadBackend::Memory:
+      cursor = CreateCursor();
+      file = cursor.get();
+      break;
+
+    case ReadBackend::MemoryMapped:
+      if (!follow_file_) {
+        auto buffer = std::make_unique<std::filebuf>();
+        if (detail::OpenMdfFile(*buffer, filename_,
+                                std::ios_base::in | std::ios_base::binary,
+                                options_.lock_wait, options_.lock_timeout)) {
+          follow_file_ = std::move(buffer);
+        }
+      }
+      file = follow_file_.get();
+      break;
+
+    default:
+      shall_close = OpenForCall();
+      if (const auto* positional = dynamic_cast<const detail::PositionalFileBuffer*>(file_.get());
+          positional != nullptr && positional->File()) {
+        // A new cursor doesn't hold bytes that were read by an earlier call
+        positional->File()->UpdateSize();
+        cursor = CreateCursor();
+        file = cursor.get();
+      } else {
+        file = file_.get();
+      }
+      break;
+  }
+  if (file == nullptr) {
+    LOG_ERROR() << "Failed to open file. File: " << filename_;
+    return false;
+  }
+
+  bool no_error = true;
+  try {
+    detail::IdBlock id_block;
+    detail::SetFilePosition(*file, 0); // A kept file is left where the last read ended
+    id_block.Read(*file);
+    uint16_t standard_flags = 0;
+    uint16_t custom_flags = 0;
+    const bool to_end = !id_block.IsFinalized(standard_flags, custom_flags) &&
+        (standard_flags & kUpdateLastDt) != 0;
+    const auto& dg4 = dynamic_cast<const detail::Dg4Block&>(data_group);
+
+    // Only the last data block in the file may grow beyond its length.
+    int64_t last_position = 0;
+    const auto* mdf4 = dynamic_cast<const detail::Mdf4File*>(instance_.get());
+    if (to_end && mdf4 != nullptr) {
+      for (const auto& dg : mdf4->Hd().Dg4()) {
+        if (dg) {
+          last_position = std::max(last_position, dg->LastDataPosition(*file));
+        }
+      }
+    }
+    auto& consumed = consumed_list_[&data_group];
+    dg4.ReadNewData(*file, to_end, last_position, consumed);
+  } catch (const std::exception &error) {
+    LOG_ERROR() << "Failed to read new data. Error: " << error.what();
+    no_error = false;
+  }
+
+  cursor.reset();
+  if (options_.handle_policy == FileHandlePolicy::OpenPerCall) {
+    follow_file_.reset();
+  }
+  if (shall_close) {
+    Close();
+  }
+  return no_error;
+}
+
+std::unique_ptr<std::streambuf> MdfReader::CreateCursor() const {
+  if (options_.backend == ReadBackend::Memory && !buffer_.empty()) {
+    return std::make_unique<detail::MemoryBuffer>(buffer_.data(), buffer_.size());
+  }
+  if (const auto* mapped = dynamic_cast<const detail::MappedFileBuffer*>(file_.get());
+      mapped != nullptr && mapped->File()) {
+    return std::make_unique<detail::MappedFileBuffer>(mapped->File());
+  }
+  if (const auto* positional = dynamic_cast<const detail::PositionalFileBuffer*>(file_.get());
+      positional != nullptr && positional->File()) {
+    return std::make_unique<detail::PositionalFileBuffer>(positional->File());
+  }
+  return {};
+}
+
 const IDataGroup *MdfReader::GetDataGroup(size_t order) const {
   const auto* file = GetFile();
   if (file != nullptr) {
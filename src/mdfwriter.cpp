@@ -54,15 +54,15 @@ bool MdfWriter::Init(const std::string& filename) {
   if (mdf_file_) {
     mdf_file_->FileName(filename);
   }
-  std::FILE* file = nullptr;
+  std::filebuf file;
   try {
     if (std::filesystem::exists(filename_)) {
       // Read in existing file so we can append to it
 
-      detail::OpenMdfFile(file,filename_, "rb");
-      if (file != nullptr) {
+      detail::OpenMdfFile(file,filename_, std::ios_base::in | std::ios_base::binary);
+      if (file.is_open()) {
         mdf_file_->ReadEverythingButData(file);
-        std::fclose(file);
+        file.close();
         write_state_ = WriteState::Finalize; // Append to the file
         LOG_DEBUG() << "Reading existing file. File: " << filename_;
         init = true;
@@ -76,8 +76,8 @@ bool MdfWriter::Init(const std::string& filename) {
       init = true;
     }
   } catch (const std::exception& err) {
-    if (file != nullptr) {
-      fclose(file);
+    if (file.is_open()) {
+      file.close();
       write_state_ = WriteState::Finalize;
       LOG_ERROR() << "Failed to read the existing MDF file. Error: " << err.what()
                   << ", File: " << filename_;
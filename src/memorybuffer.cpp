@@ -0,0 +1,131 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#include <algorithm>
+#include <cstring>
+#include <ios>
+#include "memorybuffer.h"
+
+namespace {
+constexpr size_t kLoadStep = 16 * 1024 * 1024; ///< Max bytes read by one step of a load.
+}
+
+namespace mdf::detail {
+
+MemoryBuffer::MemoryBuffer(const uint8_t *data, size_t size) {
+  Attach(data, size);
+}
+
+const uint8_t *MemoryBuffer::Data() const {
+  return reinterpret_cast<const uint8_t*>(eback());
+}
+
+size_t MemoryBuffer::Size() const {
+  return static_cast<size_t>(egptr() - eback());
+}
+
+const uint8_t *MemoryBuffer::Current() const {
+  return reinterpret_cast<const uint8_t*>(gptr());
+}
+
+size_t MemoryBuffer::Remaining() const {
+  return static_cast<size_t>(egptr() - gptr());
+}
+
+void MemoryBuffer::Attach(const uint8_t *data, size_t size, int64_t base) {
+  base_ = base;
+  // The get area is never written to, so the const cast is safe.
+  auto* begin = const_cast<char_type*>(reinterpret_cast<const char_type*>(data));
+  if (begin == nullptr) {
+    size = 0;
+  }
+  setg(begin, begin, begin + size);
+}
+
+void MemoryBuffer::Detach() {
+  base_ = 0;
+  setg(nullptr, nullptr, nullptr);
+}
+
+MemoryBuffer::pos_type MemoryBuffer::seekoff(off_type offset,
+                                             std::ios_base::seekdir dir,
+                                             std::ios_base::openmode which) {
+  off_type base = 0;
+  switch (dir) {
+    case std::ios_base::beg:
+      break;
+
+    case std::ios_base::cur:
+      base = base_ + (gptr() - eback());
+      break;
+
+    case std::ios_base::end:
+      base = base_ + (egptr() - eback());
+      break;
+
+    default:
+      return pos_type(off_type(-1));
+  }
+  return seekpos(pos_type(base + offset), which);
+}
+
+MemoryBuffer::pos_type MemoryBuffer::seekpos(pos_type position,
+                                             std::ios_base::openmode which) {
+  const auto pos = static_cast<off_type>(position) - base_;
+  if ((which & std::ios_base::in) == 0 || pos < 0 ||
+      pos > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + pos, egptr());
+  return position;
+}
+
+std::streamsize MemoryBuffer::xsgetn(char_type *dest, std::streamsize count) {
+  const auto bytes = std::min<std::streamsize>(count, egptr() - gptr());
+  if (bytes <= 0) {
+    return 0;
+  }
+  std::memcpy(dest, gptr(), static_cast<size_t>(bytes));
+  setg(eback(), gptr() + bytes, egptr());
+  return bytes;
+}
+
+std::streamsize MemoryBuffer::showmanyc() {
+  const auto bytes = egptr() - gptr();
+  return bytes > 0 ? bytes : -1;
+}
+
+void BlockBuffer::Load(std::streambuf &file, int64_t position, size_t size) {
+  // The bytes of a memory source are used in place, without a copy
+  if (const auto* memory = dynamic_cast<const MemoryBuffer*>(&file);
+      memory != nullptr && memory->Remaining() >= size) {
+    Attach(memory->Current(), size, position);
+    file.pubseekoff(static_cast<off_type>(size), std::ios_base::cur, std::ios_base::in);
+    return;
+  }
+
+  // A corrupt block length shall not allocate more memory than there are
+  // bytes in the file, so large blocks are read in steps.
+  buffer_.clear();
+  size_t count = 0;
+  while (count < size) {
+    const auto bytes = std::min(size - count, kLoadStep);
+    buffer_.resize(count + bytes);
+    const auto reads = file.sgetn(reinterpret_cast<char*>(buffer_.data() + count),
+                                  static_cast<std::streamsize>(bytes));
+    if (reads != static_cast<std::streamsize>(bytes)) {
+      throw std::ios_base::failure("Failed to read the block into memory");
+    }
+    count += bytes;
+  }
+  Attach(buffer_.data(), size, position);
+}
+
+uint8_t *BlockBuffer::Allocate(int64_t position, size_t size) {
+  buffer_.resize(size);
+  Attach(buffer_.data(), size, position);
+  return buffer_.data();
+}
+
+}  // namespace mdf::detail
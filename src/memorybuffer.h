@@ -0,0 +1,85 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+namespace mdf::detail {
+
+/** \class MemoryBuffer memorybuffer.h "memorybuffer.h"
+ * \brief Read-only stream buffer over a block of memory.
+ *
+ * The get area covers the entire memory block, so reading and seeking is
+ * done without any system calls. The buffer doesn't own the memory.
+ */
+class MemoryBuffer : public std::streambuf {
+ public:
+  MemoryBuffer() = default;
+  MemoryBuffer(const uint8_t* data, size_t size); ///< Attach a memory block.
+  ~MemoryBuffer() override = default;
+
+  MemoryBuffer(const MemoryBuffer&) = delete;
+  MemoryBuffer& operator=(const MemoryBuffer&) = delete;
+
+  [[nodiscard]] const uint8_t* Data() const; ///< Start of the memory block.
+  [[nodiscard]] size_t Size() const; ///< Size of the memory block.
+  [[nodiscard]] const uint8_t* Current() const; ///< Current read position.
+  [[nodiscard]] size_t Remaining() const; ///< Number of bytes left to read.
+ protected:
+  /** \brief Sets the memory block.
+   *
+   * @param data Start of the memory block.
+   * @param size Size of the memory block.
+   * @param base Stream position of the first byte in the block.
+   */
+  void Attach(const uint8_t* data, size_t size, int64_t base = 0);
+  void Detach(); ///< Reset the memory block.
+
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+  std::streamsize xsgetn(char_type* dest, std::streamsize count) override;
+  std::streamsize showmanyc() override;
+ private:
+  int64_t base_ = 0; ///< Stream position of the first byte.
+};
+
+/** \class BlockBuffer memorybuffer.h "memorybuffer.h"
+ * \brief Stream buffer that holds a copy of a part of a file.
+ *
+ * The buffer is filled with one read from the file and is then parsed
+ * from memory. The stream positions are the same as in the file, so
+ * file position functions works as if reading directly from the file.
+ *
+ * If the file already is in memory (memory or memory mapped backend), the
+ * buffer is a view of the file bytes instead of a copy. The view is valid
+ * as long as the file memory.
+ */
+class BlockBuffer : public MemoryBuffer {
+ public:
+  /** \brief Reads a number of bytes from the current file position.
+   *
+   * Throws if the file is shorter than the size. The memory grows with the
+   * bytes read, so an invalid size doesn't allocate more than the file size.
+   * A memory source isn't copied, see the class description.
+   * @param file File to read from.
+   * @param position Current file position.
+   * @param size Number of bytes to read.
+   */
+  void Load(std::streambuf& file, int64_t position, size_t size);
+
+  /** \brief Allocates the buffer for the caller to fill.
+   *
+   * @param position File position of the first byte.
+   * @param size Number of bytes.
+   * @return Start of the buffer.
+   */
+  uint8_t* Allocate(int64_t position, size_t size);
+ private:
+  std::vector<uint8_t> buffer_;
+};
+
+}  // namespace mdf::detail
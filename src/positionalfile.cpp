@@ -0,0 +1,360 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifdef WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // std::min and std::max
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef MDF_USE_IO_URING
+#include <liburing.h>
+#endif
+
+#include "positionalfile.h"
+
+namespace {
+constexpr size_t kBufferSize = 64 * 1024;
+
+#if defined(MDF_USE_IO_URING) && !defined(WIN32)
+constexpr size_t kQueueDepth = 64; ///< Max number of reads in the ring.
+constexpr size_t kMaxUringRead = 1024 * 1024 * 1024; ///< Max size of one read.
+
+/// Submits the reads to an io_uring and collects the completions in any
+/// order. Failed or short reads are left for the caller to complete.
+void UringReadBatch(int file, std::vector<mdf::detail::ReadRequest>& request_list) {
+  const auto depth = static_cast<unsigned>(std::min(request_list.size(), kQueueDepth));
+  io_uring ring {};
+  if (depth == 0 || io_uring_queue_init(depth, &ring, 0) < 0) {
+    return;
+  }
+  io_uring_cqe* cqe = nullptr;
+  const auto complete = [&ring, &cqe] {
+    auto* request = static_cast<mdf::detail::ReadRequest*>(io_uring_cqe_get_data(cqe));
+    if (request != nullptr && cqe->res > 0) {
+      request->bytes_read = static_cast<size_t>(cqe->res);
+    }
+    io_uring_cqe_seen(&ring, cqe);
+  };
+
+  size_t next = 0;
+  unsigned queued = 0; // Prepared and not completed reads
+  bool failed = false;
+  while (!failed) {
+    for (; next < request_list.size() && queued < depth; ++next) {
+      auto& request = request_list[next];
+      if (request.size == 0) {
+        continue;
+      }
+      auto* sqe = io_uring_get_sqe(&ring);
+      if (sqe == nullptr) {
+        break;
+      }
+      io_uring_prep_read(sqe, file, request.dest,
+                         static_cast<unsigned>(std::min(request.size, kMaxUringRead)),
+                         static_cast<uint64_t>(request.offset));
+      io_uring_sqe_set_data(sqe, &request);
+      ++queued;
+    }
+    if (queued == 0) {
+      break;
+    }
+    const int submit = io_uring_submit_and_wait(&ring, 1);
+    if (submit < 0 && submit != -EINTR && submit != -EAGAIN && submit != -EBUSY) {
+      failed = true;
+    }
+    while (io_uring_peek_cqe(&ring, &cqe) == 0) {
+      complete();
+      --queued;
+    }
+  }
+  // The buffers must not be released while the kernel still writes into them
+  for (auto in_kernel = queued - io_uring_sq_ready(&ring);
+       in_kernel > 0 && io_uring_wait_cqe(&ring, &cqe) == 0; --in_kernel) {
+    complete();
+  }
+  io_uring_queue_exit(&ring);
+}
+#endif
+}
+
+namespace mdf::detail {
+
+PositionalFile::~PositionalFile() {
+  Close();
+}
+
+int64_t PositionalFile::Size() const {
+  return size_;
+}
+
+#ifdef WIN32
+bool PositionalFile::Open(const std::string &filename) {
+  Close();
+  auto file = CreateFileA(filename.c_str(), GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER size {};
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+  file_handle_ = file;
+  size_ = size.QuadPart;
+  return true;
+}
+
+bool PositionalFile::UpdateSize() {
+  LARGE_INTEGER size {};
+  if (!IsOpen() || !GetFileSizeEx(file_handle_, &size)) {
+    return false;
+  }
+  size_ = size.QuadPart;
+  return true;
+}
+
+void PositionalFile::Close() {
+  if (file_handle_ != nullptr) {
+    CloseHandle(file_handle_);
+    file_handle_ = nullptr;
+  }
+  size_ = 0;
+}
+
+bool PositionalFile::IsOpen() const {
+  return file_handle_ != nullptr;
+}
+
+size_t PositionalFile::ReadAt(int64_t offset, void *dest, size_t size) const {
+  size_t count = 0;
+  auto* buffer = static_cast<uint8_t*>(dest);
+  while (IsOpen() && count < size) {
+    OVERLAPPED overlapped {};
+    const auto position = static_cast<uint64_t>(offset) + count;
+    overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+    const auto bytes = static_cast<DWORD>(
+        std::min<size_t>(size - count, 0x40000000));
+    DWORD read = 0;
+    if (!ReadFile(file_handle_, buffer + count, bytes, &read, &overlapped) ||
+        read == 0) {
+      break;
+    }
+    count += read;
+  }
+  return count;
+}
+
+void PositionalFile::WillNeed(int64_t, size_t) const {
+  // Windows has no read-ahead hint for a file region.
+}
+
+#else
+bool PositionalFile::Open(const std::string &filename) {
+  Close();
+  const int file = ::open(filename.c_str(), O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+  struct stat info {};
+  if (::fstat(file, &info) != 0) {
+    ::close(file);
+    return false;
+  }
+  file_handle_ = file;
+  size_ = static_cast<int64_t>(info.st_size);
+  return true;
+}
+
+bool PositionalFile::UpdateSize() {
+  struct stat info {};
+  if (!IsOpen() || ::fstat(file_handle_, &info) != 0) {
+    return false;
+  }
+  size_ = static_cast<int64_t>(info.st_size);
+  return true;
+}
+
+void PositionalFile::Close() {
+  if (file_handle_ >= 0) {
+    ::close(file_handle_);
+    file_handle_ = -1;
+  }
+  size_ = 0;
+}
+
+bool PositionalFile::IsOpen() const {
+  return file_handle_ >= 0;
+}
+
+size_t PositionalFile::ReadAt(int64_t offset, void *dest, size_t size) const {
+  size_t count = 0;
+  auto* buffer = static_cast<uint8_t*>(dest);
+  while (IsOpen() && count < size) {
+    const auto read = ::pread(file_handle_, buffer + count, size - count,
+                              static_cast<off_t>(offset + count));
+    if (read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read <= 0) {
+      break;
+    }
+    count += static_cast<size_t>(read);
+  }
+  return count;
+}
+
+void PositionalFile::WillNeed(int64_t offset, size_t size) const {
+#ifdef POSIX_FADV_WILLNEED
+  if (IsOpen()) {
+    ::posix_fadvise(file_handle_, static_cast<off_t>(offset),
+                    static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+  }
+#endif
+}
+#endif
+
+bool PositionalFile::ReadBatch(std::vector<ReadRequest>& request_list) const {
+#if defined(MDF_USE_IO_URING) && !defined(WIN32)
+  UringReadBatch(file_handle_, request_list);
+#else
+  for (const auto& request : request_list) {
+    WillNeed(request.offset, request.size);
+  }
+#endif
+  // Read what is left in file order
+  std::vector<ReadRequest*> remaining;
+  for (auto& request : request_list) {
+    if (request.bytes_read < request.size) {
+      remaining.push_back(&request);
+    }
+  }
+  std::ranges::sort(remaining, [] (const auto* first, const auto* second) {
+    return first->offset < second->offset;
+  });
+  bool complete = true;
+  for (auto* request : remaining) {
+    request->bytes_read += ReadAt(request->offset + static_cast<int64_t>(request->bytes_read),
+                                  request->dest + request->bytes_read,
+                                  request->size - request->bytes_read);
+    complete = complete && request->bytes_read == request->size;
+  }
+  return complete;
+}
+
+PositionalFileBuffer::PositionalFileBuffer(std::shared_ptr<PositionalFile> file)
+    : file_(std::move(file)),
+      buffer_(kBufferSize) {
+  setg(buffer_.data(), buffer_.data(), buffer_.data());
+}
+
+const std::shared_ptr<PositionalFile> &PositionalFileBuffer::File() const {
+  return file_;
+}
+
+void PositionalFileBuffer::WillNeed(int64_t offset, size_t size) const {
+  if (file_) {
+    file_->WillNeed(offset, size);
+  }
+}
+
+int64_t PositionalFileBuffer::Position() const {
+  return buffer_position_ + (gptr() - eback());
+}
+
+PositionalFileBuffer::int_type PositionalFileBuffer::underflow() {
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  if (!file_) {
+    return traits_type::eof();
+  }
+  buffer_position_ = Position();
+  const auto count = file_->ReadAt(buffer_position_, buffer_.data(), buffer_.size());
+  setg(buffer_.data(), buffer_.data(), buffer_.data() + count);
+  return count > 0 ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+}
+
+std::streamsize PositionalFileBuffer::xsgetn(char_type *dest, std::streamsize count) {
+  std::streamsize bytes = 0;
+  // Copy what is already in the buffer
+  const auto buffered = std::min<std::streamsize>(count, egptr() - gptr());
+  if (buffered > 0) {
+    std::memcpy(dest, gptr(), static_cast<size_t>(buffered));
+    setg(eback(), gptr() + buffered, egptr());
+    bytes += buffered;
+  }
+  if (bytes >= count || !file_) {
+    return bytes;
+  }
+
+  const auto remaining = count - bytes;
+  if (static_cast<size_t>(remaining) >= buffer_.size()) {
+    // Large reads goes directly into the destination
+    const auto position = Position();
+    const auto read = file_->ReadAt(position, dest + bytes, static_cast<size_t>(remaining));
+    buffer_position_ = position + static_cast<int64_t>(read);
+    setg(buffer_.data(), buffer_.data(), buffer_.data());
+    return bytes + static_cast<std::streamsize>(read);
+  }
+
+  if (underflow() == traits_type::eof()) {
+    return bytes;
+  }
+  const auto copy = std::min<std::streamsize>(remaining, egptr() - gptr());
+  std::memcpy(dest + bytes, gptr(), static_cast<size_t>(copy));
+  setg(eback(), gptr() + copy, egptr());
+  return bytes + copy;
+}
+
+PositionalFileBuffer::pos_type PositionalFileBuffer::seekoff(off_type offset,
+                                                             std::ios_base::seekdir dir,
+                                                             std::ios_base::openmode which) {
+  off_type base = 0;
+  switch (dir) {
+    case std::ios_base::beg:
+      break;
+
+    case std::ios_base::cur:
+      base = Position();
+      break;
+
+    case std::ios_base::end:
+      base = file_ ? file_->Size() : 0;
+      break;
+
+    default:
+      return pos_type(off_type(-1));
+  }
+  return seekpos(pos_type(base + offset), which);
+}
+
+PositionalFileBuffer::pos_type PositionalFileBuffer::seekpos(pos_type position,
+                                                             std::ios_base::openmode which) {
+  const auto pos = static_cast<int64_t>(position);
+  if ((which & std::ios_base::in) == 0 || pos < 0) {
+    return pos_type(off_type(-1));
+  }
+  const auto buffer_end = buffer_position_ + (egptr() - eback());
+  if (pos >= buffer_position_ && pos <= buffer_end) {
+    // Inside the buffer. Only move the read pointer.
+    setg(eback(), eback() + (pos - buffer_position_), egptr());
+  } else {
+    buffer_position_ = pos;
+    setg(buffer_.data(), buffer_.data(), buffer_.data());
+  }
+  return position;
+}
+
+}  // namespace mdf::detail
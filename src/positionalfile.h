@@ -0,0 +1,105 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "ireadahead.h"
+
+namespace mdf::detail {
+
+/** \brief Read request in a batch, see PositionalFile::ReadBatch(). */
+struct ReadRequest {
+  int64_t offset = 0; ///< File offset.
+  uint8_t* dest = nullptr; ///< Destination buffer.
+  size_t size = 0; ///< Number of bytes to read.
+  size_t bytes_read = 0; ///< Number of bytes read.
+};
+
+/** \class PositionalFile positionalfile.h "positionalfile.h"
+ * \brief Read-only file that is read by offset.
+ *
+ * All reads define their own file offset (pread), so the file has no shared
+ * file position. This makes it safe to read from many threads at the same time.
+ */
+class PositionalFile {
+ public:
+  PositionalFile() = default;
+  ~PositionalFile();
+
+  PositionalFile(const PositionalFile&) = delete;
+  PositionalFile& operator=(const PositionalFile&) = delete;
+
+  bool Open(const std::string& filename); ///< Opens the file for reading.
+  void Close(); ///< Closes the file.
+  [[nodiscard]] bool IsOpen() const; ///< Returns true if the file is open.
+  [[nodiscard]] int64_t Size() const; ///< Returns the file size.
+  bool UpdateSize(); ///< Reads the file size again, after the file has grown.
+
+  /** \brief Reads bytes at a file offset.
+   *
+   * The function is thread-safe.
+   * @param offset File offset.
+   * @param dest Destination buffer.
+   * @param size Number of bytes to read.
+   * @return Number of bytes read. Less than size at end of file.
+   */
+  size_t ReadAt(int64_t offset, void* dest, size_t size) const;
+
+  /** \brief Reads many file regions in one batch.
+   *
+   * If the library is built with io_uring (MDF_BUILD_IO_URING), all reads
+   * are submitted at once and complete in any order. Otherwise the regions
+   * are hinted and then read in file order. The function is thread-safe.
+   * @param request_list Regions to read.
+   * @return True if all regions were read in full.
+   */
+  bool ReadBatch(std::vector<ReadRequest>& request_list) const;
+
+  void WillNeed(int64_t offset, size_t size) const; ///< Hints that the region will be read soon.
+ private:
+#ifdef WIN32
+  void* file_handle_ = nullptr; ///< Windows file handle.
+#else
+  int file_handle_ = -1; ///< File descriptor.
+#endif
+  std::atomic<int64_t> size_ = 0; ///< File size. See UpdateSize().
+};
+
+/** \class PositionalFileBuffer positionalfile.h "positionalfile.h"
+ * \brief Stream buffer with its own file position over a positional file.
+ *
+ * Each buffer have its own file position and read buffer, so many buffers
+ * may share one file and be used in different threads.
+ */
+class PositionalFileBuffer : public std::streambuf, public IReadAhead {
+ public:
+  explicit PositionalFileBuffer(std::shared_ptr<PositionalFile> file);
+  ~PositionalFileBuffer() override = default;
+
+  PositionalFileBuffer(const PositionalFileBuffer&) = delete;
+  PositionalFileBuffer& operator=(const PositionalFileBuffer&) = delete;
+
+  [[nodiscard]] const std::shared_ptr<PositionalFile>& File() const; ///< Shared file.
+  void WillNeed(int64_t offset, size_t size) const override;
+ protected:
+  int_type underflow() override;
+  std::streamsize xsgetn(char_type* dest, std::streamsize count) override;
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+ private:
+  std::shared_ptr<PositionalFile> file_;
+  std::vector<char> buffer_;
+  int64_t buffer_position_ = 0; ///< File position of the first byte in the buffer.
+
+  [[nodiscard]] int64_t Position() const; ///< Current file position.
+};
+
+}  // namespace mdf::detail
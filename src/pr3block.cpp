@@ -12,24 +12,15 @@ Pr3Block::Pr3Block(const std::string &meta_data)
 : text_(meta_data) {
 }
 
-size_t Pr3Block::Read(std::FILE *file) {
+size_t Pr3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
 
-  std::ostringstream temp;
-  char in = '\0';
-  for (; bytes < block_size_; ++bytes) {
-    size_t nof = std::fread(&in, 1, 1, file);
-    if (nof != 1) {
-      // Suppose end of file or something
-      break;
-    }
-    if (in == '\0') {
-      // No more to read
-      break;
-    }
-    temp << in;
-  }
-  text_ = temp.str();
+  // Read the text in one read. The text ends at the first null character.
+  std::string temp(block_size_ > bytes ? block_size_ - bytes : 0, '\0');
+  const auto count = file.sgetn(temp.data(), static_cast<std::streamsize>(temp.size()));
+  temp.resize(count > 0 ? static_cast<size_t>(count) : 0);
+  text_ = temp.c_str();
+  bytes += text_.size();
 
   return bytes;
 }
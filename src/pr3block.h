@@ -13,7 +13,7 @@ class Pr3Block : public IBlock {
   Pr3Block() = default;
   explicit Pr3Block(const std::string& meta_data);
 
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
   [[nodiscard]] std::string Text() const {
     return text_;
@@ -6,7 +6,7 @@
 
 namespace mdf::detail {
 
-size_t Rd4Block::Read(std::FILE *file) {
+size_t Rd4Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader4(file);
   data_position_ = GetFilePosition(file);
   return bytes;
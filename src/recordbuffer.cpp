@@ -0,0 +1,56 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#include <algorithm>
+#include <cstring>
+#include "recordbuffer.h"
+
+namespace {
+
+constexpr size_t kChunkSize = 4 * 1024 * 1024; ///< Normal read size
+
+}  // namespace
+
+namespace mdf::detail {
+
+RecordBuffer::RecordBuffer(std::streambuf& file, uint64_t nof_bytes)
+    : file_(file),
+      remaining_(nof_bytes) {
+  buffer_.resize(static_cast<size_t>(std::min<uint64_t>(nof_bytes, kChunkSize)));
+}
+
+bool RecordBuffer::Fill(size_t size) {
+  if (Available() >= size) {
+    return true;
+  }
+  if (remaining_ == 0) {
+    return false;
+  }
+
+  // Keep the start of a record that continues in the next chunk
+  const auto tail = Available();
+  if (tail > 0 && offset_ > 0) {
+    std::memmove(buffer_.data(), buffer_.data() + offset_, tail);
+  }
+  offset_ = 0;
+  end_ = tail;
+  if (buffer_.size() < size) {
+    buffer_.resize(size); // Record larger than a chunk (VLSD)
+  }
+
+  while (end_ < size && remaining_ > 0) {
+    const auto free = std::min<uint64_t>(buffer_.size() - end_, remaining_);
+    const auto reads = file_.sgetn(reinterpret_cast<char*>(buffer_.data() + end_),
+                                   static_cast<std::streamsize>(free));
+    if (reads <= 0) {
+      remaining_ = 0;
+      break;
+    }
+    end_ += static_cast<size_t>(reads);
+    remaining_ -= static_cast<uint64_t>(reads);
+  }
+  return Available() >= size;
+}
+
+}  // namespace mdf::detail
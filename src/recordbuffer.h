@@ -0,0 +1,67 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+namespace mdf::detail {
+
+/** \class RecordBuffer recordbuffer.h "recordbuffer.h"
+ * \brief Reads data records in large chunks.
+ *
+ * The data bytes are read from the file in chunks of a few MB into a buffer
+ * that is reused during the parsing. The records are then walked in memory.
+ * The bytes of a record that straddles two chunks are moved to the start of
+ * the buffer before the next chunk is read, so the caller always sees
+ * complete records.
+ *
+ * The buffer reads forward from the current file position and never
+ * reads more than the number of data bytes.
+ */
+class RecordBuffer {
+ public:
+  /** \brief Creates the buffer.
+   *
+   * @param file File positioned at the first record.
+   * @param nof_bytes Number of data bytes to read.
+   */
+  RecordBuffer(std::streambuf& file, uint64_t nof_bytes);
+
+  RecordBuffer(const RecordBuffer&) = delete;
+  RecordBuffer& operator=(const RecordBuffer&) = delete;
+
+  /** \brief Makes sure that a number of bytes are available in memory.
+   *
+   * Any pointer returned by Current() is invalid after this call.
+   * @param size Number of bytes needed from the current position.
+   * @return False if the data bytes ended before the size.
+   */
+  [[nodiscard]] bool Fill(size_t size);
+
+  [[nodiscard]] const uint8_t* Current() const { ///< Current record bytes.
+    return buffer_.data() + offset_;
+  }
+  [[nodiscard]] size_t Available() const { ///< Number of bytes in memory.
+    return end_ - offset_;
+  }
+  void Skip(size_t size) { ///< Moves past bytes in memory.
+    offset_ += size;
+    consumed_ += size;
+  }
+  [[nodiscard]] uint64_t Consumed() const { ///< Number of bytes moved past.
+    return consumed_;
+  }
+ private:
+  std::streambuf& file_;
+  uint64_t remaining_ = 0; ///< Data bytes not yet read from the file.
+  uint64_t consumed_ = 0;
+  std::vector<uint8_t> buffer_;
+  size_t offset_ = 0; ///< Current position in the buffer.
+  size_t end_ = 0; ///< End of the read bytes in the buffer.
+};
+
+}  // namespace mdf::detail
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace mdf::detail {
+
+/** \class RecordIdTable recordidtable.h "recordidtable.h"
+ * \brief Finds the channel group of a record ID in constant time.
+ *
+ * The table is built once before the records of an unsorted data group are
+ * parsed. Record IDs below 64 Ki (1 and 2 byte IDs) are looked up in a dense
+ * table. Larger IDs are looked up in a hash map. Each entry also holds the
+ * record length, so the channel group doesn't need to be asked per record.
+ *
+ * If only one channel group is added, it is returned for any record ID. A data
+ * group with one channel group doesn't store record IDs.
+ *
+ * Entries that no observer needs are marked, so their records can be
+ * skipped without being copied or notified.
+ * @tparam T Channel group block type.
+ */
+template <typename T>
+class RecordIdTable {
+ public:
+  struct Entry {
+    T* group = nullptr;
+    size_t record_size = 0; ///< Fixed record size or 0 for VLSD records.
+    bool needed = true; ///< False if no observer needs the records.
+  };
+
+  /** \brief Adds a channel group.
+   *
+   * @param record_id Record ID of the group.
+   * @param group Channel group.
+   * @param record_size Fixed record size, excluding the record ID. 0 for VLSD records.
+   * @param needed False if the records can be skipped.
+   */
+  void Add(uint64_t record_id, T* group, size_t record_size, bool needed = true) {
+    const Entry entry = {group, record_size, needed};
+    if (record_id < kDenseSize) {
+      if (dense_list_.size() <= record_id) {
+        dense_list_.resize(static_cast<size_t>(record_id) + 1);
+      }
+      dense_list_[static_cast<size_t>(record_id)] = entry;
+    } else {
+      sparse_list_[record_id] = entry;
+    }
+    only_ = entry;
+    ++nof_groups_;
+  }
+
+  /** \brief Returns the entry of a record ID.
+   *
+   * @param record_id Record ID.
+   * @return The entry or null if no group has the record ID.
+   */
+  [[nodiscard]] const Entry* Find(uint64_t record_id) const {
+    if (nof_groups_ == 1) {
+      return &only_;
+    }
+    if (record_id < dense_list_.size()) {
+      const auto& entry = dense_list_[static_cast<size_t>(record_id)];
+      return entry.group != nullptr ? &entry : nullptr;
+    }
+    const auto itr = sparse_list_.find(record_id);
+    return itr != sparse_list_.cend() ? &itr->second : nullptr;
+  }
+ private:
+  static constexpr uint64_t kDenseSize = 0x10000;
+  std::vector<Entry> dense_list_; ///< Indexed by record ID.
+  std::unordered_map<uint64_t, Entry> sparse_list_; ///< Record IDs above the dense table.
+  Entry only_; ///< Last added entry. Used if there is only one group.
+  size_t nof_groups_ = 0;
+};
+
+}  // namespace mdf::detail
@@ -10,7 +10,7 @@ namespace mdf::detail {
 
 class Ri4Block : public DataBlock {
  public:
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
  protected:
   [[nodiscard]] size_t DataSize() const override;
 };
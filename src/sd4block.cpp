@@ -5,7 +5,7 @@
 #include "sd4block.h"
 
 namespace mdf::detail {
-size_t Sd4Block::Read(std::FILE *file) {
+size_t Sd4Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader4(file);
   data_position_ = GetFilePosition(file);
   return bytes;
@@ -7,7 +7,7 @@
 namespace mdf::detail {
 class Sd4Block : public DataBlock {
  public:
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
  protected:
   size_t DataSize() const override;
 };
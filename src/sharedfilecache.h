@@ -0,0 +1,62 @@
+/*
+ * Copyright 2022 Ingemar Hedvall
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace mdf::detail {
+
+/** \class SharedFileCache sharedfilecache.h "sharedfilecache.h"
+ * \brief Cache of open file handles keyed by path.
+ *
+ * The cache only holds weak references, so a file is closed when the last
+ * reader release it. The cache is thread-safe.
+ * @tparam T File type as MappedFile or PositionalFile.
+ */
+template <typename T>
+class SharedFileCache {
+ public:
+  static SharedFileCache& Instance() {
+    static SharedFileCache instance;
+    return instance;
+  }
+
+  /// Returns an open file or an empty pointer if not in the cache.
+  [[nodiscard]] std::shared_ptr<T> Find(const std::string& filename) {
+    std::scoped_lock lock(locker_);
+    const auto itr = cache_.find(MakeKey(filename));
+    return itr == cache_.cend() ? std::shared_ptr<T>() : itr->second.lock();
+  }
+
+  /// Adds an open file to the cache and removes released files.
+  void Add(const std::string& filename, const std::shared_ptr<T>& file) {
+    std::scoped_lock lock(locker_);
+    for (auto itr = cache_.begin(); itr != cache_.end(); /* No ++ here */) {
+      if (itr->second.expired()) {
+        itr = cache_.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+    cache_[MakeKey(filename)] = file;
+  }
+
+ private:
+  std::mutex locker_;
+  std::map<std::string, std::weak_ptr<T>> cache_;
+
+  SharedFileCache() = default;
+
+  static std::string MakeKey(const std::string& filename) {
+    std::error_code err;
+    const auto path = std::filesystem::absolute(filename, err);
+    return err ? filename : path.lexically_normal().string();
+  }
+};
+
+}  // namespace mdf::detail
@@ -71,13 +71,14 @@ void Si4Block::GetBlockProperty(BlockPropertyList &dest) const {
     md_comment_->GetBlockProperty(dest);
   }
 }
-size_t Si4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, type_);
-  bytes += ReadNumber(file, bus_type_);
-  bytes += ReadNumber(file, flags_);
+size_t Si4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, type_);
+  bytes += ReadNumber(data, bus_type_);
+  bytes += ReadNumber(data, flags_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 5);
+  bytes += ReadByte(data, reserved, 5);
   name_ = ReadTx4(file,kIndexName);
   path_ = ReadTx4(file,kIndexPath);
   ReadMdComment(file,kIndexMd);
@@ -164,11 +165,11 @@ uint8_t Si4Block::Flags() const {
 
 IMetaData *Si4Block::MetaData() {
   CreateMd4Block();
-  return dynamic_cast<IMetaData *>(md_comment_.get());
+  return dynamic_cast<IMetaData *>(MdComment());
 }
 
 const IMetaData *Si4Block::MetaData() const {
-  return !md_comment_ ? nullptr : dynamic_cast<IMetaData *>(md_comment_.get());
+  return !md_comment_ ? nullptr : dynamic_cast<const IMetaData *>(md_comment_.get());
 }
 
 
@@ -34,7 +34,7 @@ class Si4Block : public IBlock, public ISourceInformation {
   [[nodiscard]] const IMetaData *MetaData() const override;
 
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
  private:
   uint8_t type_ = 0;
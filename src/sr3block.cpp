@@ -14,7 +14,7 @@ constexpr size_t kIndexData = 1;
 
 namespace mdf::detail {
 
-size_t Sr3Block::Read(std::FILE *file) {
+size_t Sr3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadLinks3(file, 2);
   bytes += ReadNumber(file, nof_reduced_samples_);
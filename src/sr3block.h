@@ -10,7 +10,7 @@
 namespace mdf::detail {
 class Sr3Block : public DataListBlock {
  public:
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
  private:
   uint32_t nof_reduced_samples_ = 0;
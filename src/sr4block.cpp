@@ -48,14 +48,15 @@ void Sr4Block::GetBlockProperty(BlockPropertyList &dest) const {
   dest.emplace_back("Flags", MakeFlagString(flags_));
 }
 
-size_t Sr4Block::Read(std::FILE *file) {
-  size_t bytes = ReadHeader4(file);
-  bytes += ReadNumber(file, nof_samples_);
-  bytes += ReadNumber(file, interval_);
-  bytes += ReadNumber(file, type_);
-  bytes += ReadNumber(file, flags_);
+size_t Sr4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  size_t bytes = ReadHeader4(file, data);
+  bytes += ReadNumber(data, nof_samples_);
+  bytes += ReadNumber(data, interval_);
+  bytes += ReadNumber(data, type_);
+  bytes += ReadNumber(data, flags_);
   std::vector<uint8_t> reserved;
-  bytes += ReadByte(file, reserved, 6);
+  bytes += ReadByte(data, reserved, 6);
   ReadBlockList(file, kIndexData);
   return bytes;
 }
@@ -9,7 +9,7 @@ namespace mdf::detail {
 class Sr4Block : public DataListBlock {
  public:
   void GetBlockProperty(BlockPropertyList& dest) const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
  private:
   uint64_t nof_samples_ = 0;
   double interval_ = 0;
@@ -13,7 +13,7 @@ namespace mdf::detail {
 std::string Tr3Block::Comment() const {
   return comment_;
 }
-size_t Tr3Block::Read(std::FILE *file) {
+size_t Tr3Block::Read(std::streambuf& file) {
   size_t bytes = ReadHeader3(file);
   bytes += ReadLinks3(file, 1);
   bytes += ReadNumber(file, nof_events_);
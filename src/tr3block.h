@@ -18,7 +18,7 @@ struct Tr3Event {
 class Tr3Block : public IBlock {
  public:
   [[nodiscard]] std::string Comment() const override;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
  private:
   uint16_t nof_events_ = 0;
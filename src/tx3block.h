@@ -10,7 +10,7 @@ class Tx3Block : public IBlock {
  public:
   explicit Tx3Block(const std::string& text);
   Tx3Block() = default;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE *file) override;
   [[nodiscard]] std::string Text() const;
 
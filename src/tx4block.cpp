@@ -2,6 +2,7 @@
  * Copyright 2021 Ingemar Hedvall
  * SPDX-License-Identifier: MIT
  */
+#include <algorithm>
 #include <sstream>
 #include "tx4block.h"
 #include "util/stringutil.h"
@@ -34,24 +35,14 @@ bool Tx4Block::IsTxtBlock() const {
   return util::string::IEquals(block_type_, "##TX", 4);
 }
 
-size_t Tx4Block::Read(std::FILE *file) {
-  auto bytes = ReadHeader4(file);
+size_t Tx4Block::Read(std::streambuf& file) {
+  BlockBuffer data;
+  auto bytes = ReadHeader4(file, data);
 
-  std::ostringstream temp;
-  char in = '\0';
-  for (; bytes < block_size_; ++bytes) {
-    auto nof = std::fread(&in, 1, 1, file);
-    if (nof != 1) {
-      // Suppose end of file or something
-      break;
-    }
-    if (in == '\0') {
-      // No more to read
-      break;
-    }
-    temp << in;
-  }
-  text_ = temp.str();
+  // The text ends at the first null character
+  const auto* text = reinterpret_cast<const char*>(data.Current());
+  text_.assign(text, std::find(text, text + data.Remaining(), '\0'));
+  bytes += text_.size();
 
   return bytes;
 }
@@ -18,7 +18,7 @@ class Tx4Block : public IBlock {
 
   void GetBlockProperty(BlockPropertyList& dest) const override;
   [[nodiscard]] bool IsTxtBlock() const;
-  size_t Read(std::FILE *file) override;
+  size_t Read(std::streambuf& file) override;
   size_t Write(std::FILE* file) override;
 
   [[nodiscard]] std::string Text() const;
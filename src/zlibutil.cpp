@@ -2,17 +2,243 @@
  * Copyright 2022 Ingemar Hedvall
  * SPDX-License-Identifier: MIT
  */
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
 #include <cstring>
 #include <string>
 #include <filesystem>
+#include <memory>
+#if defined(MDF_USE_ZLIB_NG)
+#include <zlib-ng.h>
+#else
 #include <zlib.h>
+#endif
+#if defined(MDF_USE_LIBDEFLATE)
+#include <libdeflate.h>
+#endif
 #include "mdf/zlibutil.h"
+
+#if defined(__AVX2__)
+#define MDF_TRANSPOSE_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MDF_TRANSPOSE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(MDF_TRANSPOSE_AVX2)
+#include <immintrin.h>
+#endif
+
+// The codec is selected at build time. zlib-ng in native mode has the zlib API
+// with prefixed names. libdeflate only has whole-buffer functions, so zlib is
+// still used for the streaming functions.
+#if defined(MDF_USE_ZLIB_NG)
+#define MDF_ZLIB(name) zng_##name
+#else
+#define MDF_ZLIB(name) name
+#endif
+
 namespace
 {
 constexpr size_t kZlibChunk = 16384;
+constexpr int kDefaultLevel = 6; ///< Same level as Z_DEFAULT_COMPRESSION.
+
+#if defined(MDF_USE_ZLIB_NG)
+using ZStream = zng_stream;
+#else
+using ZStream = z_stream;
+#endif
+
+#if defined(MDF_USE_LIBDEFLATE)
+struct CompressorDeleter {
+  void operator()(libdeflate_compressor* compressor) const {
+    libdeflate_free_compressor(compressor);
+  }
+};
+
+struct DecompressorDeleter {
+  void operator()(libdeflate_decompressor* decompressor) const {
+    libdeflate_free_decompressor(decompressor);
+  }
+};
+
+///< Returns the compressor of the thread. It is reused between the calls.
+libdeflate_compressor* Compressor() {
+  thread_local std::unique_ptr<libdeflate_compressor, CompressorDeleter> compressor(
+      libdeflate_alloc_compressor(kDefaultLevel));
+  return compressor.get();
+}
+
+///< Returns the decompressor of the thread. It is reused between the calls.
+libdeflate_decompressor* Decompressor() {
+  thread_local std::unique_ptr<libdeflate_decompressor, DecompressorDeleter> decompressor(
+      libdeflate_alloc_decompressor());
+  return decompressor.get();
+}
+#endif
+}
+
+namespace {
+
+constexpr size_t kScalarBlock = 32; ///< Tile size of the scalar transpose.
+
+///< Scalar transpose of a part of a rows x cols matrix, tile by tile.
+void TransposeBlock(const uint8_t* src, uint8_t* dst, size_t rows, size_t cols,
+                    size_t row_begin, size_t row_end, size_t col_begin, size_t col_end) {
+  for (size_t row0 = row_begin; row0 < row_end; row0 += kScalarBlock) {
+    const auto row1 = std::min(row_end, row0 + kScalarBlock);
+    for (size_t col0 = col_begin; col0 < col_end; col0 += kScalarBlock) {
+      const auto col1 = std::min(col_end, col0 + kScalarBlock);
+      for (size_t row = row0; row < row1; ++row) {
+        for (size_t col = col0; col < col1; ++col) {
+          dst[col * rows + row] = src[row * cols + col];
+        }
+      }
+    }
+  }
+}
+
+#if defined(MDF_TRANSPOSE_SSE2)
+/* The SIMD kernels interleave N vectors of 16 (32) bytes in log2(N) rounds of
+ * byte unpacks. With N = 16, this is a transpose of a 16 x 16 byte tile. With
+ * N = 2, 4 or 8, it interleaves N rows into 16 (32) columns of N bytes, which
+ * is the inverse transpose of a block with small records. The AVX2 unpacks
+ * work on each 128-bit lane, so each lane holds its own 16 columns.
+ */
+template <size_t N>
+void Interleave(__m128i (&x)[N]) {
+  for (size_t round = N; round > 1; round /= 2) {
+    __m128i y[N];
+    for (size_t index = 0; index < N / 2; ++index) {
+      y[2 * index] = _mm_unpacklo_epi8(x[index], x[index + N / 2]);
+      y[2 * index + 1] = _mm_unpackhi_epi8(x[index], x[index + N / 2]);
+    }
+    std::copy(std::begin(y), std::end(y), std::begin(x));
+  }
+}
+
+///< Transposes a 16 x 16 tile.
+void Tile16(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride) {
+  __m128i x[16];
+  for (size_t row = 0; row < 16; ++row) {
+    x[row] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + row * src_stride));
+  }
+  Interleave(x);
+  for (size_t col = 0; col < 16; ++col) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + col * dst_stride), x[col]);
+  }
+}
+
+///< Interleaves N rows of 16 columns into 16 columns of N bytes.
+template <size_t N>
+void Columns16(const uint8_t* src, size_t src_stride, uint8_t* dst) {
+  __m128i x[N];
+  for (size_t row = 0; row < N; ++row) {
+    x[row] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + row * src_stride));
+  }
+  Interleave(x);
+  for (size_t index = 0; index < N; ++index) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + index * 16), x[index]);
+  }
+}
+#endif
+
+#if defined(MDF_TRANSPOSE_AVX2)
+template <size_t N>
+void Interleave(__m256i (&x)[N]) {
+  for (size_t round = N; round > 1; round /= 2) {
+    __m256i y[N];
+    for (size_t index = 0; index < N / 2; ++index) {
+      y[2 * index] = _mm256_unpacklo_epi8(x[index], x[index + N / 2]);
+      y[2 * index + 1] = _mm256_unpackhi_epi8(x[index], x[index + N / 2]);
+    }
+    std::copy(std::begin(y), std::end(y), std::begin(x));
+  }
+}
+
+///< Transposes a 16 x 32 tile as two 16 x 16 tiles, one in each lane.
+void Tile32(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride) {
+  __m256i x[16];
+  for (size_t row = 0; row < 16; ++row) {
+    x[row] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + row * src_stride));
+  }
+  Interleave(x);
+  for (size_t col = 0; col < 16; ++col) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + col * dst_stride),
+                     _mm256_castsi256_si128(x[col]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (col + 16) * dst_stride),
+                     _mm256_extracti128_si256(x[col], 1));
+  }
+}
+
+///< Interleaves N rows of 32 columns into 32 columns of N bytes.
+template <size_t N>
+void Columns32(const uint8_t* src, size_t src_stride, uint8_t* dst) {
+  __m256i x[N];
+  for (size_t row = 0; row < N; ++row) {
+    x[row] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + row * src_stride));
+  }
+  Interleave(x);
+  for (size_t index = 0; index < N; ++index) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + index * 16),
+                     _mm256_castsi256_si128(x[index]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (N + index) * 16),
+                     _mm256_extracti128_si256(x[index], 1));
+  }
+}
+#endif
+
+///< Interleaves N rows into columns of N bytes. Used for small record sizes.
+template <size_t N>
+void InterleaveRows(const uint8_t* src, uint8_t* dst, size_t cols) {
+  size_t col = 0;
+#if defined(MDF_TRANSPOSE_AVX2)
+  for (; col + 32 <= cols; col += 32) {
+    Columns32<N>(src + col, cols, dst + col * N);
+  }
+#endif
+#if defined(MDF_TRANSPOSE_SSE2)
+  for (; col + 16 <= cols; col += 16) {
+    Columns16<N>(src + col, cols, dst + col * N);
+  }
+#endif
+  TransposeBlock(src, dst, N, cols, 0, N, col, cols);
+}
+
+///< Transposes a rows x cols matrix into a cols x rows matrix.
+void TransposeMatrix(const uint8_t* src, uint8_t* dst, size_t rows, size_t cols) {
+  switch (rows) {
+    case 2: InterleaveRows<2>(src, dst, cols); return;
+    case 4: InterleaveRows<4>(src, dst, cols); return;
+    case 8: InterleaveRows<8>(src, dst, cols); return;
+    default: break;
+  }
+  size_t row_done = 0;
+  size_t col_done = 0;
+#if defined(MDF_TRANSPOSE_SSE2)
+  if (rows >= 16 && cols >= 16) {
+    row_done = rows - rows % 16;
+    col_done = cols - cols % 16;
+    for (size_t row = 0; row < row_done; row += 16) {
+      size_t col = 0;
+#if defined(MDF_TRANSPOSE_AVX2)
+      for (; col + 32 <= col_done; col += 32) {
+        Tile32(src + row * cols + col, cols, dst + col * rows + row, rows);
+      }
+#endif
+      for (; col < col_done; col += 16) {
+        Tile16(src + row * cols + col, cols, dst + col * rows + row, rows);
+      }
+    }
+  }
+#endif
+  TransposeBlock(src, dst, rows, cols, row_done, rows, 0, cols);
+  TransposeBlock(src, dst, rows, cols, 0, row_done, col_done, cols);
 }
 
+}  // namespace
+
 namespace mdf {
 
 
@@ -21,11 +247,11 @@ bool Deflate(FILE *in, FILE *out) {
     return false;
   }
 
-  z_stream s {};
+  ZStream s {};
   std::vector<uint8_t> buf_in(kZlibChunk, 0);
   std::vector<uint8_t> buf_out(kZlibChunk,0);
 
-  auto ret = deflateInit(&s,  Z_DEFAULT_COMPRESSION);
+  auto ret = MDF_ZLIB(deflateInit)(&s,  kDefaultLevel);
   if (ret != Z_OK) {
     return false;
   }
@@ -33,9 +259,9 @@ bool Deflate(FILE *in, FILE *out) {
   /* compress until end of file */
   int flush;
   do {
-    s.avail_in = static_cast<uInt>(fread(buf_in.data(), 1, kZlibChunk, in));
+    s.avail_in = static_cast<uint32_t>(fread(buf_in.data(), 1, kZlibChunk, in));
     if (ferror(in)) {
-      deflateEnd(&s);
+      MDF_ZLIB(deflateEnd)(&s);
       return false;
     }
 
@@ -47,13 +273,13 @@ bool Deflate(FILE *in, FILE *out) {
     do {
       s.avail_out = kZlibChunk;
       s.next_out = buf_out.data();
-      ret = deflate(&s, flush);    /* no bad return value */
+      ret = MDF_ZLIB(deflate)(&s, flush);    /* no bad return value */
       if (ret == Z_STREAM_ERROR) {  /* state not clobbered */
         return false;
       }
       const auto have = kZlibChunk - s.avail_out;
       if (fwrite(buf_out.data(), 1, have, out) != have || ferror(out)) {
-        deflateEnd(&s);
+        MDF_ZLIB(deflateEnd)(&s);
         return false;
       }
     } while (s.avail_out == 0);
@@ -68,7 +294,7 @@ bool Deflate(FILE *in, FILE *out) {
   }
 
   /* clean up and return */
-  deflateEnd(&s);
+  MDF_ZLIB(deflateEnd)(&s);
   return true;
 }
 
@@ -105,26 +331,40 @@ bool Deflate(const ByteArray& buf_in, ByteArray& buf_out) {
     buf_out.resize(100,0);
   }
 
-  z_stream s {};
-  auto ret = deflateInit(&s,  Z_DEFAULT_COMPRESSION);
+#if defined(MDF_USE_LIBDEFLATE)
+  auto* compressor = Compressor();
+  if (compressor == nullptr) {
+    return false;
+  }
+  const auto compress = libdeflate_zlib_compress(compressor, buf_in.data(), buf_in.size(),
+                                                 buf_out.data(), buf_out.size());
+  if (compress == 0) {
+    return false; // Output buffer too small
+  }
+  buf_out.resize(compress);
+  return true;
+#else
+  ZStream s {};
+  auto ret = MDF_ZLIB(deflateInit)(&s,  kDefaultLevel);
   if (ret != Z_OK) {
     return false;
   }
 
-  s.avail_in = static_cast<uInt>(buf_in.size());
-  s.next_in = const_cast<Bytef*>(buf_in.data());
+  s.avail_in = static_cast<uint32_t>(buf_in.size());
+  s.next_in = const_cast<uint8_t*>(buf_in.data());
 
-  s.avail_out = static_cast<uInt>(buf_out.size());
-  s.next_out = const_cast<Bytef*>(buf_out.data());
-  ret = deflate(&s, Z_FINISH);    /* no bad return value */
+  s.avail_out = static_cast<uint32_t>(buf_out.size());
+  s.next_out = const_cast<uint8_t*>(buf_out.data());
+  ret = MDF_ZLIB(deflate)(&s, Z_FINISH);    /* no bad return value */
   if (ret == Z_STREAM_ERROR) {  /* state not clobbered */
     return false;
   }
-  const auto compress = static_cast<uInt>(buf_out.size()) - s.avail_out;
+  const auto compress = static_cast<uint32_t>(buf_out.size()) - s.avail_out;
   /* clean up and return */
-  deflateEnd(&s);
+  MDF_ZLIB(deflateEnd)(&s);
   buf_out.resize(compress);
   return ret == Z_STREAM_END;
+#endif
 }
 
 bool Inflate(std::FILE* in, std::FILE* out)
@@ -133,10 +373,10 @@ bool Inflate(std::FILE* in, std::FILE* out)
     return false;
   }
   // Inflate the input file to the output file
-  z_stream o{};
+  ZStream o{};
   ByteArray buf_in(kZlibChunk, 0);
   ByteArray buf_out(kZlibChunk,0);
-  auto ret = inflateInit(&o);
+  auto ret = MDF_ZLIB(inflateInit)(&o);
   if (ret != Z_OK) {
     return false;
   }
@@ -144,9 +384,9 @@ bool Inflate(std::FILE* in, std::FILE* out)
 
   /* decompress until deflate stream ends or end of file */
   do {
-    o.avail_in = static_cast<uInt>(fread(buf_in.data(), 1, kZlibChunk, in));
+    o.avail_in = static_cast<uint32_t>(fread(buf_in.data(), 1, kZlibChunk, in));
     if (ferror(in)) {
-      inflateEnd(&o);
+      MDF_ZLIB(inflateEnd)(&o);
       return false;
     }
     if (o.avail_in == 0) {
@@ -158,7 +398,7 @@ bool Inflate(std::FILE* in, std::FILE* out)
     do {
       o.avail_out = kZlibChunk;
       o.next_out = buf_out.data();
-      ret = inflate(&o, Z_NO_FLUSH);
+      ret = MDF_ZLIB(inflate)(&o, Z_NO_FLUSH);
 
       switch (ret) {
         case Z_STREAM_ERROR:
@@ -167,7 +407,7 @@ bool Inflate(std::FILE* in, std::FILE* out)
         case Z_NEED_DICT:
         case Z_DATA_ERROR:
         case Z_MEM_ERROR:
-          inflateEnd(&o);
+          MDF_ZLIB(inflateEnd)(&o);
           return false;
 
         default:
@@ -175,14 +415,14 @@ bool Inflate(std::FILE* in, std::FILE* out)
       }
       const auto have = kZlibChunk - o.avail_out;
       if (fwrite(buf_out.data(), 1, have, out) != have || ferror(out)) {
-        inflateEnd(&o);
+        MDF_ZLIB(inflateEnd)(&o);
         return false;
       }
     } while (o.avail_out == 0);
   } while (ret != Z_STREAM_END);
 
   /* clean up and return */
-  inflateEnd(&o);
+  MDF_ZLIB(inflateEnd)(&o);
   return ret == Z_STREAM_END;
 }
 
@@ -191,10 +431,10 @@ bool Inflate(std::FILE *in, std::FILE *out, uint64_t nof_bytes) {
     return false;
   }
   // Inflate the input file to the output file
-  z_stream o{};
+  ZStream o{};
   ByteArray buf_in(kZlibChunk, 0);
   ByteArray buf_out(kZlibChunk,0);
-  auto ret = inflateInit(&o);
+  auto ret = MDF_ZLIB(inflateInit)(&o);
   if (ret != Z_OK) {
     return false;
   }
@@ -212,9 +452,9 @@ bool Inflate(std::FILE *in, std::FILE *out, uint64_t nof_bytes) {
       bytes_to_read = nof_bytes - count;
     }
 
-    o.avail_in = static_cast<uInt>(fread(buf_in.data(), 1, bytes_to_read, in));
+    o.avail_in = static_cast<uint32_t>(fread(buf_in.data(), 1, bytes_to_read, in));
     if (ferror(in)) {
-      inflateEnd(&o);
+      MDF_ZLIB(inflateEnd)(&o);
       return false;
     }
     if (o.avail_in == 0) {
@@ -227,7 +467,7 @@ bool Inflate(std::FILE *in, std::FILE *out, uint64_t nof_bytes) {
     do {
       o.avail_out = kZlibChunk;
       o.next_out = buf_out.data();
-      ret = inflate(&o, Z_NO_FLUSH);
+      ret = MDF_ZLIB(inflate)(&o, Z_NO_FLUSH);
 
       switch (ret) {
         case Z_STREAM_ERROR:
@@ -236,7 +476,7 @@ bool Inflate(std::FILE *in, std::FILE *out, uint64_t nof_bytes) {
         case Z_NEED_DICT:
         case Z_DATA_ERROR:
         case Z_MEM_ERROR:
-          inflateEnd(&o);
+          MDF_ZLIB(inflateEnd)(&o);
           return false;
 
         default:
@@ -244,34 +484,111 @@ bool Inflate(std::FILE *in, std::FILE *out, uint64_t nof_bytes) {
       }
       const auto have = kZlibChunk - o.avail_out;
       if (fwrite(buf_out.data(), 1, have, out) != have || ferror(out)) {
-        inflateEnd(&o);
+        MDF_ZLIB(inflateEnd)(&o);
         return false;
       }
     } while (o.avail_out == 0);
   } while (ret != Z_STREAM_END);
 
   /* clean up and return */
-  inflateEnd(&o);
+  MDF_ZLIB(inflateEnd)(&o);
   return ret == Z_STREAM_END;
 }
 
-bool Inflate(const ByteArray& buf_in, ByteArray& buf_out)
-{
-  if (buf_in.empty() || buf_out.empty()) {
+bool Inflate(std::streambuf& in, std::streambuf& out, uint64_t nof_bytes) {
+  // Inflate the input stream to the output stream
+  ZStream o{};
+  ByteArray buf_in(kZlibChunk, 0);
+  ByteArray buf_out(kZlibChunk,0);
+  auto ret = MDF_ZLIB(inflateInit)(&o);
+  if (ret != Z_OK) {
     return false;
   }
-  // Inflate the input file to the output file
-  z_stream o{};
-  auto ret = inflateInit(&o);
+
+  uint64_t count = 0;
+  /* decompress until deflate stream ends or end of input */
+  do {
+    if (count >= nof_bytes) {
+      break; // Ready
+    }
+
+    size_t bytes_to_read = kZlibChunk;
+    if (count + kZlibChunk > nof_bytes) {
+      bytes_to_read = nof_bytes - count;
+    }
+
+    o.avail_in = static_cast<uint32_t>(
+        in.sgetn(reinterpret_cast<char*>(buf_in.data()),
+                 static_cast<std::streamsize>(bytes_to_read)));
+    if (o.avail_in == 0) {
+      break;
+    }
+    o.next_in = buf_in.data();
+    count += bytes_to_read;
+
+    /* run inflate() on input until output buffer not full */
+    do {
+      o.avail_out = kZlibChunk;
+      o.next_out = buf_out.data();
+      ret = MDF_ZLIB(inflate)(&o, Z_NO_FLUSH);
+
+      switch (ret) {
+        case Z_STREAM_ERROR:
+          return false;
+
+        case Z_NEED_DICT:
+        case Z_DATA_ERROR:
+        case Z_MEM_ERROR:
+          MDF_ZLIB(inflateEnd)(&o);
+          return false;
+
+        default:
+          break;
+      }
+      const auto have = static_cast<std::streamsize>(kZlibChunk - o.avail_out);
+      if (out.sputn(reinterpret_cast<const char*>(buf_out.data()), have) != have) {
+        MDF_ZLIB(inflateEnd)(&o);
+        return false;
+      }
+    } while (o.avail_out == 0);
+  } while (ret != Z_STREAM_END);
+
+  /* clean up and return */
+  MDF_ZLIB(inflateEnd)(&o);
+  return ret == Z_STREAM_END;
+}
+
+bool Inflate(const uint8_t* in, size_t in_size, uint8_t* out, size_t& out_size) {
+  if (in == nullptr || in_size == 0 || out == nullptr || out_size == 0) {
+    return false;
+  }
+  // Single-shot inflate. The output is sized to the inflated size
+  // (orig_data_length in a DZ block), so the whole input is inflated in one call.
+#if defined(MDF_USE_LIBDEFLATE)
+  auto* decompressor = Decompressor();
+  if (decompressor == nullptr) {
+    return false;
+  }
+  size_t inflated = 0;
+  const auto result = libdeflate_zlib_decompress(decompressor, in, in_size,
+                                                 out, out_size, &inflated);
+  if (result != LIBDEFLATE_SUCCESS) {
+    return false;
+  }
+  out_size = inflated;
+  return true;
+#else
+  ZStream o{};
+  auto ret = MDF_ZLIB(inflateInit)(&o);
   if (ret != Z_OK) {
     return false;
   }
 
-  o.avail_in = static_cast<uInt>(buf_in.size());
-  o.next_in = const_cast<Bytef*>(buf_in.data());
-  o.avail_out = static_cast<uInt>(buf_out.size());
-  o.next_out = buf_out.data();
-  ret = inflate(&o, Z_NO_FLUSH);
+  o.avail_in = static_cast<uint32_t>(in_size);
+  o.next_in = const_cast<uint8_t*>(in);
+  o.avail_out = static_cast<uint32_t>(out_size);
+  o.next_out = out;
+  ret = MDF_ZLIB(inflate)(&o, Z_FINISH);
 
   switch (ret) {
     case Z_STREAM_ERROR:
@@ -280,22 +597,31 @@ bool Inflate(const ByteArray& buf_in, ByteArray& buf_out)
     case Z_NEED_DICT:
     case Z_DATA_ERROR:
     case Z_MEM_ERROR:
-      inflateEnd(&o);
+      MDF_ZLIB(inflateEnd)(&o);
       return false;
 
     default:
       break;
   }
-  if (o.avail_out > 0) {
-    const auto iCompress = static_cast<uInt>(buf_out.size()) - o.avail_out;
-    buf_out.resize(iCompress);
-  }
+  out_size -= o.avail_out;
   if (o.avail_in > 0) {
-    inflateEnd(&o);
+    MDF_ZLIB(inflateEnd)(&o);
     return false;
   }
-  inflateEnd(&o);
+  MDF_ZLIB(inflateEnd)(&o);
   return ret == Z_STREAM_END;
+#endif
+}
+
+bool Inflate(const ByteArray& buf_in, ByteArray& buf_out)
+{
+  if (buf_in.empty() || buf_out.empty()) {
+    return false;
+  }
+  size_t size = buf_out.size();
+  const bool inflate = Inflate(buf_in.data(), buf_in.size(), buf_out.data(), size);
+  buf_out.resize(size);
+  return inflate;
 }
 
 bool Inflate(const ByteArray& buf_in, std::FILE* to_file)
@@ -306,20 +632,20 @@ bool Inflate(const ByteArray& buf_in, std::FILE* to_file)
 
 
   // Inflate the input file to the output file
-  z_stream o{};
+  ZStream o{};
 
   ByteArray buf_out(kZlibChunk,0);
-  auto ret = inflateInit(&o);
+  auto ret = MDF_ZLIB(inflateInit)(&o);
   if (ret != Z_OK) {
     return false;
   }
-  o.avail_in = static_cast<uInt>(buf_in.size());
-  o.next_in = const_cast<Bytef*>(buf_in.data());
+  o.avail_in = static_cast<uint32_t>(buf_in.size());
+  o.next_in = const_cast<uint8_t*>(buf_in.data());
      /* run inflate() on input until output buffer not full */
    do {
      o.avail_out = kZlibChunk;
      o.next_out = buf_out.data();
-     ret = inflate(&o, Z_NO_FLUSH);
+     ret = MDF_ZLIB(inflate)(&o, Z_NO_FLUSH);
 
     switch (ret) {
       case Z_STREAM_ERROR:
@@ -328,7 +654,7 @@ bool Inflate(const ByteArray& buf_in, std::FILE* to_file)
       case Z_NEED_DICT:
       case Z_DATA_ERROR:
       case Z_MEM_ERROR:
-        inflateEnd(&o);
+        MDF_ZLIB(inflateEnd)(&o);
         return false;
 
       default:
@@ -336,32 +662,67 @@ bool Inflate(const ByteArray& buf_in, std::FILE* to_file)
     }
     const auto have = kZlibChunk - o.avail_out;
     if (fwrite(buf_out.data(), 1, have, to_file) != have || ferror(to_file)) {
-      inflateEnd(&o);
+      MDF_ZLIB(inflateEnd)(&o);
       return false;
     }
   } while (o.avail_out == 0);
 
   /* clean up and return */
-  inflateEnd(&o);
+  MDF_ZLIB(inflateEnd)(&o);
   return ret == Z_STREAM_END;
 }
 
-void Transpose(ByteArray& data, size_t record_size)
-{
+std::string DeflateBackend() {
+#if defined(MDF_USE_ZLIB_NG)
+  return "zlib-ng";
+#elif defined(MDF_USE_LIBDEFLATE)
+  return "libdeflate";
+#else
+  return "zlib";
+#endif
+}
+
+void Transpose(const ByteArray& in, ByteArray& out, size_t record_size) {
+  out.resize(in.size());
+  if (record_size == 0 || in.empty()) {
+    std::copy(in.begin(), in.end(), out.begin());
+    return;
+  }
+  // Only complete records are transposed. The tail bytes are copied as is.
+  const size_t rows = in.size() / record_size;
+  TransposeMatrix(in.data(), out.data(), rows, record_size);
+  const size_t done = rows * record_size;
+  std::copy(in.begin() + static_cast<std::ptrdiff_t>(done), in.end(),
+            out.begin() + static_cast<std::ptrdiff_t>(done));
+}
+
+void InvTranspose(const uint8_t* in, uint8_t* out, size_t size, size_t record_size) {
+  if (in == nullptr || out == nullptr) {
+    return;
+  }
   if (record_size == 0) {
+    std::copy(in, in + size, out);
     return;
   }
+  const size_t rows = size / record_size;
+  TransposeMatrix(in, out, record_size, rows);
+  const size_t done = rows * record_size;
+  std::copy(in + done, in + size, out + done);
+}
 
-  ByteArray temp(data);
-  const size_t rows = data.size() / record_size;
-  const size_t columns = record_size;
-  for (size_t row = 0; row < rows; ++row) {
-    for (size_t column = 0; column < columns; ++column) {
-      const size_t from = row * columns + column;
-      const size_t to = column * rows + row;
-      data[to] = temp[from];
-    }
+void InvTranspose(const ByteArray& in, ByteArray& out, size_t record_size) {
+  out.resize(in.size());
+  InvTranspose(in.data(), out.data(), in.size(), record_size);
+}
+
+void Transpose(ByteArray& data, size_t record_size)
+{
+  if (record_size == 0) {
+    return;
   }
+  ByteArray temp;
+  Transpose(data, temp, record_size);
+  data.swap(temp);
 }
 
 void InvTranspose(ByteArray& data, size_t record_size)
@@ -369,18 +730,9 @@ void InvTranspose(ByteArray& data, size_t record_size)
   if (record_size == 0) {
     return;
   }
-  ByteArray temp(data);
-  const size_t rows = data.size() / record_size;
-  const size_t columns = record_size;
-  for (size_t row = 0; row < rows; ++row) {
-    for (size_t column = 0; column < columns; ++column) {
-      const size_t to = row * columns + column;
-      const size_t from = column * rows + row;
-      data[to] = temp[from];
-    }
-  }
+  ByteArray temp;
+  InvTranspose(data, temp, record_size);
+  data.swap(temp);
 }
 
-
-
 }
@@ -2,16 +2,27 @@
  * Copyright 2021 Ingemar Hedvall
  * SPDX-License-Identifier: MIT
  */
+#include <algorithm>
 #include <string>
 #include <map>
 #include <filesystem>
 #include <chrono>
+#include <thread>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <cstring>
 #include "util/logconfig.h"
 #include "util/stringutil.h"
 #include "util/logstream.h"
 #include "mdf/mdfreader.h"
+#include "mdf/zlibutil.h"
 #include "mdf3file.h"
 #include "mdf4file.h"
+#include "datalistbuffer.h"
+#include "recordbuffer.h"
+#include "recordidtable.h"
+#include "linklist.h"
 #include "testread.h"
 using namespace std::filesystem;
 using namespace util::string;
@@ -32,6 +43,188 @@ std::string GetMdfFile(const std::string &name) {
   return itr == mdf_list.cend() ? std::string() : itr->second;
 }
 
+/// Packs little endian values into a byte string.
+template <typename... T>
+std::string Pack(T... values) {
+  std::string data;
+  (data.append(reinterpret_cast<const char*>(&values), sizeof(values)), ...);
+  return data;
+}
+
+/** \brief Builds an MDF4 file in memory.
+ *
+ * Used to create unfinished files that grows between the reads.
+ */
+class Mdf4Bytes {
+ public:
+  explicit Mdf4Bytes(uint16_t unfinished_flags) {
+    bytes_ = unfinished_flags != 0 ? "UnFinMF " : "MDF     ";
+    bytes_ += "4.10    test    ";
+    bytes_ += Pack(uint16_t{0}, uint16_t{0}, uint16_t{410}, uint16_t{0});
+    bytes_.append(28, '\0');
+    bytes_ += Pack(unfinished_flags, uint16_t{0});
+  }
+
+  int64_t Block(const std::string& type, const std::vector<int64_t>& link_list,
+                const std::string& data) {
+    bytes_.resize((bytes_.size() + 7) / 8 * 8, '\0');
+    const auto position = static_cast<int64_t>(bytes_.size());
+    bytes_ += type;
+    bytes_ += Pack(uint32_t{0}, static_cast<uint64_t>(24 + (link_list.size() * 8) + data.size()),
+                   static_cast<uint64_t>(link_list.size()));
+    for (const auto link : link_list) {
+      bytes_ += Pack(link);
+    }
+    bytes_ += data;
+    return position;
+  }
+
+  int64_t Tx(const std::string& text) {
+    return Block("##TX", {}, text + std::string(8 - (text.size() % 8), '\0'));
+  }
+
+  int64_t Cn(const std::string& name, uint8_t type, uint8_t sync, uint8_t data_type,
+             uint32_t byte_offset, uint32_t bit_count) {
+    const auto name_link = Tx(name);
+    const auto data = Pack(type, sync, data_type, uint8_t{0}, byte_offset, bit_count,
+                           uint32_t{0}, uint32_t{0}, uint8_t{0}, uint8_t{0}, uint16_t{0}) +
+                      std::string(6 * sizeof(double), '\0');
+    return Block("##CN", {0, 0, name_link, 0, 0, 0, 0, 0}, data);
+  }
+
+  void Link(int64_t block, size_t index, int64_t link) {
+    std::memcpy(bytes_.data() + block + 24 + (index * 8), &link, sizeof(link));
+  }
+
+  void Length(int64_t block, uint64_t length) {
+    std::memcpy(bytes_.data() + block + 8, &length, sizeof(length));
+  }
+
+  void LinkCount(int64_t block, uint64_t nof_links) {
+    std::memcpy(bytes_.data() + block + 16, &nof_links, sizeof(nof_links));
+  }
+
+  void Save(const std::string& filename) const {
+    std::ofstream file(filename, std::ios_base::binary | std::ios_base::trunc);
+    file.write(bytes_.data(), static_cast<std::streamsize>(bytes_.size()));
+  }
+
+ private:
+  std::string bytes_;
+};
+
+/** \brief Creates a small MDF4 file with two data groups.
+ *
+ * The first data group is sorted and its data is a DL block with one DT and
+ * one DZ block. The second data group is unsorted and has two channel groups.
+ * The Counter channels have a linear conversion (0.5 + 2 * counter).
+ */
+void CreateTestFile(const std::string& filename) {
+  constexpr size_t kNofSamples = 1'000;
+  Mdf4Bytes file(0);
+  const auto hd = file.Block("##HD", {0, 0, 0, 0, 0, 0},
+                             Pack(uint64_t{0}, int16_t{0}, int16_t{0}, uint32_t{0},
+                                  0.0, 0.0));
+  const auto cc = file.Block("##CC", {0, 0, 0, 0},
+                             Pack(uint8_t{1}, uint8_t{0}, uint16_t{0}, uint16_t{0},
+                                  uint16_t{2}, 0.0, 0.0, 0.5, 2.0));
+  const auto add_channels = [&] (int64_t cg, bool counter) {
+    const auto time = file.Cn("Time", 2, 1, 4, 0, 64);
+    file.Link(cg, 1, time);
+    if (counter) {
+      const auto cn = file.Cn("Counter", 0, 0, 0, 8, 32);
+      file.Link(cn, 4, cc);
+      file.Link(time, 0, cn);
+    }
+  };
+  const auto record = [] (size_t sample) {
+    return Pack(static_cast<double>(sample) / 100, static_cast<uint32_t>(sample));
+  };
+
+  const auto dg1 = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{0}));
+  const auto cg1 = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                              Pack(uint64_t{0}, uint64_t{kNofSamples}, uint32_t{0},
+                                   uint32_t{0}, uint32_t{12}, uint32_t{0}));
+  add_channels(cg1, true);
+  std::string dt_data;
+  std::string dz_data;
+  for (size_t sample = 0; sample < kNofSamples; ++sample) {
+    (sample < kNofSamples / 2 ? dt_data : dz_data) += record(sample);
+  }
+  const ByteArray raw(dz_data.cbegin(), dz_data.cend());
+  ByteArray compressed(raw.size() + 100, 0);
+  Deflate(raw, compressed);
+  const auto dt = file.Block("##DT", {}, dt_data);
+  const auto dz = file.Block("##DZ", {},
+      "DT" + Pack(uint8_t{0}, uint8_t{0}, uint32_t{0}, static_cast<uint64_t>(raw.size()),
+                  static_cast<uint64_t>(compressed.size())) +
+      std::string(compressed.cbegin(), compressed.cend()));
+  const auto dl = file.Block("##DL", {0, dt, dz},
+                             Pack(uint8_t{1}, uint8_t{0}, uint16_t{0}, uint32_t{2},
+                                  static_cast<uint64_t>(dt_data.size())));
+  file.Link(hd, 0, dg1);
+  file.Link(dg1, 1, cg1);
+  file.Link(dg1, 2, dl);
+
+  const auto dg2 = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{1}));
+  const auto cg2 = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                              Pack(uint64_t{1}, uint64_t{kNofSamples}, uint32_t{0},
+                                   uint32_t{0}, uint32_t{12}, uint32_t{0}));
+  add_channels(cg2, true);
+  const auto cg3 = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                              Pack(uint64_t{2}, uint64_t{kNofSamples / 2}, uint32_t{0},
+                                   uint32_t{0}, uint32_t{8}, uint32_t{0}));
+  add_channels(cg3, false);
+  std::string unsorted_data;
+  for (size_t sample = 0; sample < kNofSamples; ++sample) {
+    unsorted_data += Pack(uint8_t{1}) + record(sample);
+    if (sample % 2 == 0) {
+      unsorted_data += Pack(uint8_t{2}, static_cast<double>(sample) / 100);
+    }
+  }
+  file.Link(dg1, 0, dg2);
+  file.Link(dg2, 1, cg2);
+  file.Link(cg2, 0, cg3);
+  file.Link(dg2, 2, file.Block("##DT", {}, unsorted_data));
+  file.Save(filename);
+}
+
+using ValueList = std::vector<std::vector<double>>; ///< Engineering values per observer.
+
+ValueList ObserverValues(const ChannelObserverList& observer_list) {
+  ValueList value_list;
+  for (const auto& observer : observer_list) {
+    auto& values = value_list.emplace_back(observer->NofSamples());
+    for (size_t sample = 0; sample < values.size(); ++sample) {
+      observer->GetEngValue(sample, values[sample]);
+    }
+  }
+  return value_list;
+}
+
+/// Reads the values of all channels in the file. Returns an empty list on failure.
+ValueList ReadValues(MdfReader& reader) {
+  if (!reader.ReadEverythingButData()) {
+    return {};
+  }
+  DataGroupList dg_list;
+  reader.GetFile()->DataGroups(dg_list);
+  ValueList value_list;
+  for (auto* dg : dg_list) {
+    ChannelObserverList observer_list;
+    for (const auto* cg : dg->ChannelGroups()) {
+      CreateChannelObserverForChannelGroup(*dg, *cg, observer_list);
+    }
+    if (!reader.ReadData(*dg)) {
+      return {};
+    }
+    for (auto& values : ObserverValues(observer_list)) {
+      value_list.push_back(std::move(values));
+    }
+  }
+  return value_list;
+}
+
 }
 
 namespace mdf::test {
@@ -115,6 +308,887 @@ TEST_F(TestRead, IdBlock) //NOLINT
 
 }
 
+TEST_F(TestRead, ReadBackend) //NOLINT
+{
+  const auto filename = (temp_directory_path() / "read_backend.mf4").string();
+  CreateTestFile(filename);
+  MdfReader stream_read(filename);
+  const auto expected = ReadValues(stream_read);
+  ASSERT_EQ(expected.size(), 5);
+  ASSERT_EQ(expected[1].size(), 1'000);
+  EXPECT_DOUBLE_EQ(expected[0][700], 7.0);   // Time in the DZ block
+  EXPECT_DOUBLE_EQ(expected[1][700], 1400.5); // Counter in the DZ block
+  ASSERT_EQ(expected[4].size(), 500);
+
+  for (auto backend : {ReadBackend::FileStream, ReadBackend::MemoryMapped,
+                       ReadBackend::Positional}) {
+    MdfReader backend_read(filename, backend);
+    EXPECT_TRUE(backend_read.IsOk());
+    EXPECT_EQ(ReadValues(backend_read), expected);
+  }
+  remove(filename);
+}
+
+TEST_F(TestRead, ReadFromMemory) //NOLINT
+{
+  const auto filename = (temp_directory_path() / "read_memory.mf4").string();
+  CreateTestFile(filename);
+  MdfReader file_read(filename);
+  const auto expected = ReadValues(file_read);
+  ASSERT_FALSE(expected.empty());
+
+  std::vector<uint8_t> buffer;
+  {
+    std::ifstream file(filename, std::ios_base::in | std::ios_base::binary);
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  remove(filename);
+  // The file is removed, so all blocks must be read from the buffer
+  MdfReader memory_read(buffer);
+  EXPECT_TRUE(memory_read.IsOk());
+  EXPECT_EQ(memory_read.Backend(), ReadBackend::Memory);
+  EXPECT_EQ(ReadValues(memory_read), expected);
+}
+
+TEST_F(TestRead, LazyChannels) //NOLINT
+{
+  MdfReaderOptions options;
+  options.lazy_channels = true;
+
+  // A channel with unit, comment and conversion. The comment is an MD block.
+  const auto filename = (temp_directory_path() / "lazy_channels.mf4").string();
+  Mdf4Bytes file(0);
+  const auto hd = file.Block("##HD", {0, 0, 0, 0, 0, 0},
+                             Pack(uint64_t{0}, int16_t{0}, int16_t{0}, uint32_t{0},
+                                  0.0, 0.0));
+  const auto dg = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{0}));
+  const auto cg = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                             Pack(uint64_t{0}, uint64_t{0}, uint32_t{0}, uint32_t{0},
+                                  uint32_t{12}, uint32_t{0}));
+  const auto time = file.Cn("Time", 2, 1, 4, 0, 64);
+  const auto speed = file.Cn("Speed", 0, 0, 0, 8, 32);
+  const auto unit = file.Tx("km/h");
+  const std::string xml = "<CNcomment><TX>Vehicle speed</TX></CNcomment>";
+  const auto comment = file.Block("##MD", {}, xml + std::string(8 - (xml.size() % 8), '\0'));
+  const auto cc = file.Block("##CC", {0, 0, 0, 0},
+                             Pack(uint8_t{1}, uint8_t{0}, uint16_t{0}, uint16_t{0},
+                                  uint16_t{2}, 0.0, 0.0, 0.5, 0.1));
+  file.Link(hd, 0, dg);
+  file.Link(dg, 1, cg);
+  file.Link(cg, 1, time);
+  file.Link(time, 0, speed);
+  file.Link(speed, 4, cc);
+  file.Link(speed, 6, unit);
+  file.Link(speed, 7, comment);
+  file.Save(filename);
+
+  const auto speed_channel = [] (const MdfReader& reader) -> const Cn4Block* {
+    DataGroupList dg_list;
+    reader.GetFile()->DataGroups(dg_list);
+    if (dg_list.size() != 1 || dg_list[0]->ChannelGroups().size() != 1) {
+      return nullptr;
+    }
+    const auto cn_list = dg_list[0]->ChannelGroups()[0]->Channels();
+    return cn_list.size() != 2 ? nullptr : dynamic_cast<const Cn4Block*>(cn_list[1]);
+  };
+  {
+    MdfReader eager_file(filename);
+    ASSERT_TRUE(eager_file.ReadEverythingButData());
+    MdfReader lazy_file(filename, options);
+    ASSERT_TRUE(lazy_file.ReadEverythingButData());
+    const auto* eager_cn = speed_channel(eager_file);
+    const auto* lazy_cn = speed_channel(lazy_file);
+    ASSERT_TRUE(eager_cn != nullptr && lazy_cn != nullptr);
+    // The first access of each accessor reads the deferred blocks
+    ASSERT_TRUE(lazy_cn->Md4() != nullptr);
+    ASSERT_TRUE(eager_cn->Md4() != nullptr);
+    EXPECT_EQ(lazy_cn->Md4()->Text(), eager_cn->Md4()->Text());
+    EXPECT_EQ(lazy_cn->Md4()->XmlSnippet(), xml);
+    EXPECT_EQ(lazy_cn->Comment(), eager_cn->Comment());
+    EXPECT_EQ(lazy_cn->Description(), eager_cn->Description());
+    EXPECT_EQ(lazy_cn->Unit(), "km/h");
+    EXPECT_EQ(lazy_cn->Unit(), eager_cn->Unit());
+    ASSERT_TRUE(lazy_cn->ChannelConversion() != nullptr);
+    EXPECT_EQ(lazy_cn->ChannelConversion()->Type(), eager_cn->ChannelConversion()->Type());
+
+    // Setting a comment before the first access is not replaced by the deferred read
+    MdfReader edit_file(filename, options);
+    ASSERT_TRUE(edit_file.ReadEverythingButData());
+    auto* edit_cn = const_cast<Cn4Block*>(speed_channel(edit_file));
+    ASSERT_TRUE(edit_cn != nullptr);
+    edit_cn->Description("New comment");
+    EXPECT_EQ(edit_cn->Unit(), "km/h");
+    EXPECT_EQ(edit_cn->Description(), "New comment");
+  }
+  remove(filename);
+
+  for (const auto &itr: mdf_list) {
+    MdfReader eager_read(itr.second);
+    EXPECT_TRUE(eager_read.ReadEverythingButData()) << itr.second;
+    DataGroupList eager_list;
+    eager_read.GetFile()->DataGroups(eager_list);
+
+    MdfReader lazy_read(itr.second, options);
+    EXPECT_TRUE(lazy_read.ReadEverythingButData()) << itr.second;
+    DataGroupList lazy_list;
+    lazy_read.GetFile()->DataGroups(lazy_list);
+    ASSERT_EQ(eager_list.size(), lazy_list.size()) << itr.second;
+    for (size_t dg = 0; dg < lazy_list.size(); ++dg) {
+      const auto eager_groups = eager_list[dg]->ChannelGroups();
+      const auto lazy_groups = lazy_list[dg]->ChannelGroups();
+      ASSERT_EQ(eager_groups.size(), lazy_groups.size()) << itr.second;
+      for (size_t cg = 0; cg < lazy_groups.size(); ++cg) {
+        const auto eager_channels = eager_groups[cg]->Channels();
+        const auto lazy_channels = lazy_groups[cg]->Channels();
+        ASSERT_EQ(eager_channels.size(), lazy_channels.size()) << itr.second;
+        for (size_t cn = 0; cn < lazy_channels.size(); ++cn) {
+          EXPECT_EQ(eager_channels[cn]->Name(), lazy_channels[cn]->Name());
+          EXPECT_EQ(eager_channels[cn]->Unit(), lazy_channels[cn]->Unit());
+          EXPECT_EQ(eager_channels[cn]->ChannelConversion() == nullptr,
+                    lazy_channels[cn]->ChannelConversion() == nullptr);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(TestRead, BlockArena) //NOLINT
+{
+  const auto filename = (temp_directory_path() / "block_arena.mf4").string();
+  CreateTestFile(filename);
+  MdfReader default_read(filename);
+  const auto expected = ReadValues(default_read);
+  ASSERT_FALSE(expected.empty());
+
+  MdfReaderOptions options;
+  options.block_arena = true;
+  for (const size_t parse_threads : {0, 4}) {
+    options.parse_threads = parse_threads;
+    MdfReader reader(filename, options);
+    EXPECT_EQ(ReadValues(reader), expected);
+  }
+  remove(filename);
+}
+
+TEST_F(TestRead, ParseThreads) //NOLINT
+{
+  // Each data group is read by its own thread
+  const auto filename = (temp_directory_path() / "parse_threads.mf4").string();
+  CreateTestFile(filename);
+  MdfReader serial_read(filename);
+  const auto expected = ReadValues(serial_read);
+  ASSERT_FALSE(expected.empty());
+
+  MdfReaderOptions options;
+  options.parse_threads = 4;
+  MdfReader parallel_read(filename, options);
+  EXPECT_EQ(ReadValues(parallel_read), expected);
+
+  DataGroupList serial_list;
+  serial_read.GetFile()->DataGroups(serial_list);
+  DataGroupList parallel_list;
+  parallel_read.GetFile()->DataGroups(parallel_list);
+  ASSERT_EQ(serial_list.size(), parallel_list.size());
+  for (size_t dg = 0; dg < parallel_list.size(); ++dg) {
+    const auto serial_groups = serial_list[dg]->ChannelGroups();
+    const auto parallel_groups = parallel_list[dg]->ChannelGroups();
+    ASSERT_EQ(serial_groups.size(), parallel_groups.size());
+    for (size_t cg = 0; cg < parallel_groups.size(); ++cg) {
+      const auto serial_channels = serial_groups[cg]->Channels();
+      const auto parallel_channels = parallel_groups[cg]->Channels();
+      ASSERT_EQ(serial_channels.size(), parallel_channels.size());
+      for (size_t cn = 0; cn < parallel_channels.size(); ++cn) {
+        EXPECT_EQ(serial_channels[cn]->Name(), parallel_channels[cn]->Name());
+        EXPECT_EQ(serial_channels[cn]->ChannelConversion() == nullptr,
+                  parallel_channels[cn]->ChannelConversion() == nullptr);
+      }
+    }
+  }
+  remove(filename);
+}
+
+TEST_F(TestRead, InflateThreads) //NOLINT
+{
+  MdfReaderOptions options;
+  options.inflate_threads = 4;
+  for (const auto &itr: mdf_list) {
+    MdfReader serial_read(itr.second);
+    EXPECT_TRUE(serial_read.ReadEverythingButData()) << itr.second;
+    DataGroupList serial_list;
+    serial_read.GetFile()->DataGroups(serial_list);
+
+    MdfReader parallel_read(itr.second, options);
+    EXPECT_TRUE(parallel_read.ReadEverythingButData()) << itr.second;
+    DataGroupList parallel_list;
+    parallel_read.GetFile()->DataGroups(parallel_list);
+    ASSERT_EQ(serial_list.size(), parallel_list.size()) << itr.second;
+    for (size_t dg = 0; dg < parallel_list.size(); ++dg) {
+      ChannelObserverList serial_observers;
+      for (auto* cg : serial_list[dg]->ChannelGroups()) {
+        CreateChannelObserverForChannelGroup(*serial_list[dg], *cg, serial_observers);
+      }
+      ChannelObserverList parallel_observers;
+      for (auto* cg : parallel_list[dg]->ChannelGroups()) {
+        CreateChannelObserverForChannelGroup(*parallel_list[dg], *cg, parallel_observers);
+      }
+      EXPECT_TRUE(serial_read.ReadData(*serial_list[dg])) << itr.second;
+      EXPECT_TRUE(parallel_read.ReadData(*parallel_list[dg])) << itr.second;
+      ASSERT_EQ(serial_observers.size(), parallel_observers.size()) << itr.second;
+      for (size_t index = 0; index < parallel_observers.size(); ++index) {
+        const auto& serial = serial_observers[index];
+        const auto& parallel = parallel_observers[index];
+        ASSERT_EQ(serial->NofSamples(), parallel->NofSamples()) << itr.second;
+        for (size_t sample = 0; sample < parallel->NofSamples(); ++sample) {
+          std::string serial_value;
+          std::string parallel_value;
+          serial->GetChannelValue(sample, serial_value);
+          parallel->GetChannelValue(sample, parallel_value);
+          EXPECT_EQ(serial_value, parallel_value) << itr.second;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(TestRead, SkipUnobservedGroups) //NOLINT
+{
+  for (const auto &itr: mdf_list) {
+    MdfReader reader(itr.second);
+    EXPECT_TRUE(reader.ReadEverythingButData()) << itr.second;
+    DataGroupList dg_list;
+    reader.GetFile()->DataGroups(dg_list);
+    for (auto* dg : dg_list) {
+      const auto cg_list = dg->ChannelGroups();
+      if (cg_list.size() < 2) {
+        continue;
+      }
+      // Only the last group is observed. The other records are skipped.
+      const auto* cg = cg_list.back();
+      ChannelObserverList observer_list;
+      CreateChannelObserverForChannelGroup(*dg, *cg, observer_list);
+      EXPECT_TRUE(dg->IsRecordIdNeeded(cg->RecordId())) << itr.second;
+      EXPECT_FALSE(dg->IsRecordIdNeeded(cg_list.front()->RecordId())) << itr.second;
+      EXPECT_TRUE(reader.ReadData(*dg)) << itr.second;
+      EXPECT_EQ(cg->Sample(), cg->NofSamples()) << itr.second;
+      for (const auto& observer : observer_list) {
+        EXPECT_EQ(observer->NofSamples(), cg->NofSamples()) << itr.second;
+      }
+    }
+  }
+}
+
+TEST_F(TestRead, ReadSampleRange) //NOLINT
+{
+  for (const auto &itr: mdf_list) {
+    MdfReader reader(itr.second);
+    EXPECT_TRUE(reader.ReadEverythingButData()) << itr.second;
+    DataGroupList dg_list;
+    reader.GetFile()->DataGroups(dg_list);
+    for (auto* dg : dg_list) {
+      ChannelObserverList observer_list;
+      for (auto* cg : dg->ChannelGroups()) {
+        CreateChannelObserverForChannelGroup(*dg, *cg, observer_list);
+      }
+      EXPECT_TRUE(reader.ReadData(*dg)) << itr.second;
+      std::vector<std::vector<double>> full_list;
+      for (const auto& observer : observer_list) {
+        auto& values = full_list.emplace_back(observer->NofSamples());
+        for (size_t sample = 0; sample < values.size(); ++sample) {
+          observer->GetChannelValue(sample, values[sample]);
+        }
+      }
+
+      // The observers only hold the range after a ranged read
+      constexpr size_t kNofSamples = 10;
+      EXPECT_TRUE(reader.ReadData(*dg, 3, kNofSamples)) << itr.second;
+      for (size_t index = 0; index < observer_list.size(); ++index) {
+        const auto& observer = observer_list[index];
+        const auto& values = full_list[index];
+        const auto first = std::min<size_t>(3, values.size());
+        ASSERT_EQ(observer->FirstSample(), first) << itr.second;
+        ASSERT_EQ(observer->NofSamples(), std::min(kNofSamples, values.size() - first)) << itr.second;
+        for (size_t sample = 0; sample < observer->NofSamples(); ++sample) {
+          double value = 0;
+          observer->GetChannelValue(sample, value);
+          EXPECT_EQ(value, values[first + sample]) << itr.second;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(TestRead, ReadUnsortedSampleRange) //NOLINT
+{
+  // Three channel groups in one data group. Only the first group is observed
+  // and the third group has no samples. The parsing shall stop when the first
+  // group has passed the range.
+  constexpr size_t kNofSamples = 100;
+  const auto filename = (temp_directory_path() / "unsorted_range.mf4").string();
+  Mdf4Bytes file(0);
+  const auto hd = file.Block("##HD", {0, 0, 0, 0, 0, 0},
+                             Pack(uint64_t{0}, int16_t{0}, int16_t{0}, uint32_t{0},
+                                  0.0, 0.0));
+  const auto dg = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{1}));
+  file.Link(hd, 0, dg);
+  int64_t prev_cg = 0;
+  for (uint64_t record_id = 1; record_id <= 3; ++record_id) {
+    const auto cg = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                               Pack(record_id, record_id < 3 ? uint64_t{kNofSamples} : 0,
+                                    uint32_t{0}, uint32_t{0}, uint32_t{8}, uint32_t{0}));
+    file.Link(cg, 1, file.Cn("Time" + std::to_string(record_id), 2, 1, 4, 0, 64));
+    file.Link(prev_cg == 0 ? dg : prev_cg, prev_cg == 0 ? 1 : 0, cg);
+    prev_cg = cg;
+  }
+  std::string dt_data;
+  for (size_t sample = 0; sample < kNofSamples; ++sample) {
+    dt_data += Pack(uint8_t{1}, static_cast<double>(sample)) +
+        Pack(uint8_t{2}, static_cast<double>(sample));
+  }
+  file.Link(dg, 2, file.Block("##DT", {}, dt_data));
+  file.Save(filename);
+
+  MdfReader reader(filename);
+  ASSERT_TRUE(reader.ReadEverythingButData());
+  DataGroupList dg_list;
+  reader.GetFile()->DataGroups(dg_list);
+  ASSERT_EQ(dg_list.size(), 1);
+  const auto cg_list = dg_list[0]->ChannelGroups();
+  ASSERT_EQ(cg_list.size(), 3);
+  ChannelObserverList observer_list;
+  CreateChannelObserverForChannelGroup(*dg_list[0], *cg_list[0], observer_list);
+  ASSERT_EQ(observer_list.size(), 1);
+
+  EXPECT_TRUE(reader.ReadData(*dg_list[0], 10, 5));
+  ASSERT_EQ(observer_list[0]->NofSamples(), 5);
+  for (size_t sample = 0; sample < 5; ++sample) {
+    double value = 0;
+    observer_list[0]->GetChannelValue(sample, value);
+    EXPECT_EQ(value, static_cast<double>(10 + sample));
+  }
+  EXPECT_LT(cg_list[1]->Sample(), kNofSamples); // Stopped before the end
+  remove(filename);
+}
+
+TEST_F(TestRead, ReadTimeRange) //NOLINT
+{
+  for (const auto &itr: mdf_list) {
+    MdfReader reader(itr.second);
+    EXPECT_TRUE(reader.ReadEverythingButData()) << itr.second;
+    if (!reader.IsOk() || reader.GetFile() == nullptr || !reader.GetFile()->IsMdf4()) {
+      continue;
+    }
+    DataGroupList dg_list;
+    reader.GetFile()->DataGroups(dg_list);
+    for (auto* dg : dg_list) {
+      ChannelObserverList observer_list;
+      for (auto* cg : dg->ChannelGroups()) {
+        CreateChannelObserverForChannelGroup(*dg, *cg, observer_list);
+      }
+      const auto master = std::ranges::find_if(observer_list, [] (const auto& observer) {
+        return observer->IsMaster();
+      });
+      if (master == observer_list.cend()) {
+        continue;
+      }
+      EXPECT_TRUE(reader.ReadData(*dg)) << itr.second;
+      std::vector<double> time_list((*master)->NofSamples());
+      for (size_t sample = 0; sample < time_list.size(); ++sample) {
+        (*master)->GetEngValue(sample, time_list[sample]);
+      }
+      if (time_list.size() < 4 || !std::ranges::is_sorted(time_list)) {
+        continue;
+      }
+
+      const double start = time_list[time_list.size() / 4];
+      const double end = time_list[time_list.size() / 2];
+      if (!reader.ReadTimeRange(*dg, start, end)) {
+        continue; // Not a sorted group with fixed length records
+      }
+      const auto first = std::ranges::lower_bound(time_list, start) - time_list.cbegin();
+      const auto last = std::ranges::upper_bound(time_list, end) - time_list.cbegin();
+      EXPECT_EQ((*master)->FirstSample(), static_cast<size_t>(first)) << itr.second;
+      EXPECT_EQ((*master)->NofSamples(), static_cast<size_t>(last - first)) << itr.second;
+    }
+  }
+}
+
+TEST_F(TestRead, FollowMode) //NOLINT
+{
+  // The writer appends records and VLSD strings to an unfinished file between
+  // the reads. The length of the last DT block isn't updated (flag 0x04). The
+  // DT block of the first data group isn't the last block in the file.
+  const auto filename = (temp_directory_path() / "follow_mode.mf4").string();
+  const auto text = [](size_t sample) {
+    return "Text " + std::to_string(sample);
+  };
+  const auto write_file = [&](size_t nof_first, size_t nof_second) {
+    Mdf4Bytes file(0x04);
+    const auto hd = file.Block("##HD", {0, 0, 0, 0, 0, 0},
+                               Pack(uint64_t{0}, int16_t{0}, int16_t{0}, uint32_t{0},
+                                    0.0, 0.0));
+    const auto dg1 = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{0}));
+    const auto cg1 = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                                Pack(uint64_t{0}, uint64_t{0}, uint32_t{0},
+                                     uint32_t{0}, uint32_t{20}, uint32_t{0}));
+    const auto time1 = file.Cn("Time", 2, 1, 4, 0, 64);
+    const auto value1 = file.Cn("Value", 0, 0, 0, 8, 32);
+    const auto text1 = file.Cn("Text", 1, 0, 7, 12, 64);
+    const auto dg2 = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{0}));
+    const auto cg2 = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                                Pack(uint64_t{0}, uint64_t{0}, uint32_t{0},
+                                     uint32_t{0}, uint32_t{8}, uint32_t{0}));
+    const auto time2 = file.Cn("Time2", 2, 1, 4, 0, 64);
+    file.Link(hd, 0, dg1);
+    file.Link(dg1, 0, dg2);
+    file.Link(dg1, 1, cg1);
+    file.Link(cg1, 1, time1);
+    file.Link(time1, 0, value1);
+    file.Link(value1, 0, text1);
+    file.Link(dg2, 1, cg2);
+    file.Link(cg2, 1, time2);
+
+    if (nof_first > 0) {
+      std::string sd_data;
+      std::string dt_data;
+      for (size_t sample = 0; sample < nof_first; ++sample) {
+        dt_data += Pack(static_cast<double>(sample) * 0.1, static_cast<uint32_t>(sample * 10),
+                        static_cast<uint64_t>(sd_data.size()));
+        sd_data += Pack(static_cast<uint32_t>(text(sample).size())) + text(sample);
+      }
+      const auto sd1 = file.Block("##SD", {}, sd_data);
+      const auto dt1 = file.Block("##DT", {}, dt_data);
+      file.Link(text1, 5, sd1);
+      file.Link(dg1, 2, dt1);
+    }
+    if (nof_second > 0) {
+      std::string dt_data;
+      for (size_t sample = 0; sample < nof_second; ++sample) {
+        dt_data += Pack(static_cast<double>(sample));
+      }
+      const auto dt2 = file.Block("##DT", {}, dt_data);
+      file.Length(dt2, 24); // Not updated by the writer
+      file.Link(dg2, 2, dt2);
+    }
+    file.Save(filename);
+  };
+
+  for (const auto backend : {ReadBackend::FileStream, ReadBackend::MemoryMapped,
+                             ReadBackend::Positional}) {
+    for (const auto policy : {FileHandlePolicy::KeepOpen, FileHandlePolicy::OpenPerCall}) {
+      SCOPED_TRACE(testing::Message() << "Backend: " << static_cast<int>(backend)
+                                      << ", Policy: " << static_cast<int>(policy));
+      write_file(0, 0);
+      MdfReaderOptions options;
+      options.backend = backend;
+      options.handle_policy = policy;
+      MdfReader reader(filename, options);
+      ASSERT_TRUE(reader.ReadEverythingButData());
+      const auto* mdf4 = dynamic_cast<const Mdf4File*>(reader.GetFile());
+      ASSERT_TRUE(mdf4 != nullptr);
+      const auto& dg_list = mdf4->Hd().Dg4();
+      ASSERT_EQ(dg_list.size(), 2);
+      std::vector<ChannelObserverList> observer_list(dg_list.size());
+      for (size_t index = 0; index < dg_list.size(); ++index) {
+        for (auto* cg : dg_list[index]->ChannelGroups()) {
+          CreateChannelObserverForChannelGroup(*dg_list[index], *cg, observer_list[index]);
+        }
+      }
+      ASSERT_EQ(observer_list[0].size(), 3);
+      ASSERT_EQ(observer_list[1].size(), 1);
+
+      // No data block yet
+      EXPECT_TRUE(reader.ReadNewData(*dg_list[0]));
+      EXPECT_TRUE(reader.ReadNewData(*dg_list[1]));
+      EXPECT_EQ(observer_list[0][0]->NofSamples(), 0);
+      EXPECT_EQ(observer_list[1][0]->NofSamples(), 0);
+
+      for (const auto& [nof_first, nof_second] : {std::pair<size_t, size_t>{2, 3}, {5, 7}, {5, 7}}) {
+        write_file(nof_first, nof_second);
+        EXPECT_TRUE(reader.ReadNewData(*dg_list[0]));
+        EXPECT_TRUE(reader.ReadNewData(*dg_list[1]));
+        for (const auto& observer : observer_list[0]) {
+          ASSERT_EQ(observer->NofSamples(), nof_first) << observer->Name();
+        }
+        for (size_t sample = 0; sample < nof_first; ++sample) {
+          double time = 0;
+          uint32_t value = 0;
+          std::string value_text;
+          EXPECT_TRUE(observer_list[0][0]->GetChannelValue(sample, time));
+          EXPECT_TRUE(observer_list[0][1]->GetChannelValue(sample, value));
+          EXPECT_TRUE(observer_list[0][2]->GetChannelValue(sample, value_text));
+          EXPECT_DOUBLE_EQ(time, static_cast<double>(sample) * 0.1);
+          EXPECT_EQ(value, sample * 10);
+          EXPECT_EQ(value_text, text(sample));
+        }
+        ASSERT_EQ(observer_list[1][0]->NofSamples(), nof_second);
+        for (size_t sample = 0; sample < nof_second; ++sample) {
+          double time = 0;
+          EXPECT_TRUE(observer_list[1][0]->GetChannelValue(sample, time));
+          EXPECT_DOUBLE_EQ(time, static_cast<double>(sample));
+        }
+      }
+#ifndef WIN32
+      // A kept file handle still reads the file after it has been renamed
+      const auto moved = filename + ".moved";
+      rename(filename, moved);
+      EXPECT_EQ(reader.ReadNewData(*dg_list[0]), policy == FileHandlePolicy::KeepOpen);
+      rename(moved, filename);
+#endif
+    }
+  }
+  remove(filename);
+}
+
+TEST_F(TestRead, CorruptDzBlock) //NOLINT
+{
+  // The second DZ block fails to inflate. The read shall fail instead of
+  // parsing the bytes of the first block again.
+  constexpr size_t kNofSamples = 10;
+  ByteArray raw;
+  for (size_t sample = 0; sample < kNofSamples; ++sample) {
+    const auto value = Pack(static_cast<double>(sample));
+    raw.insert(raw.end(), value.cbegin(), value.cend());
+  }
+  ByteArray compressed(raw.size() + 100, 0);
+  ASSERT_TRUE(Deflate(raw, compressed));
+  const ByteArray corrupt(compressed.size(), 0xFF);
+  const auto dz_data = [&](const ByteArray& data) {
+    return "DT" + Pack(uint8_t{0}, uint8_t{0}, uint32_t{0}, static_cast<uint64_t>(raw.size()),
+                       static_cast<uint64_t>(data.size())) +
+        std::string(data.cbegin(), data.cend());
+  };
+
+  const auto filename = (temp_directory_path() / "corrupt_dz.mf4").string();
+  Mdf4Bytes file(0);
+  const auto hd = file.Block("##HD", {0, 0, 0, 0, 0, 0},
+                             Pack(uint64_t{0}, int16_t{0}, int16_t{0}, uint32_t{0},
+                                  0.0, 0.0));
+  const auto dg = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{0}));
+  const auto cg = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                             Pack(uint64_t{0}, static_cast<uint64_t>(2 * kNofSamples),
+                                  uint32_t{0}, uint32_t{0}, uint32_t{8}, uint32_t{0}));
+  const auto time = file.Cn("Time", 2, 1, 4, 0, 64);
+  const auto dz1 = file.Block("##DZ", {}, dz_data(compressed));
+  const auto dz2 = file.Block("##DZ", {}, dz_data(corrupt));
+  const auto dl = file.Block("##DL", {0, dz1, dz2},
+                             Pack(uint8_t{1}, uint8_t{0}, uint16_t{0}, uint32_t{2},
+                                  static_cast<uint64_t>(raw.size())));
+  file.Link(hd, 0, dg);
+  file.Link(dg, 1, cg);
+  file.Link(dg, 2, dl);
+  file.Link(cg, 1, time);
+  file.Save(filename);
+
+  for (const auto backend : {ReadBackend::FileStream, ReadBackend::Positional}) {
+    for (const size_t inflate_threads : {0, 4}) {
+      MdfReaderOptions options;
+      options.backend = backend;
+      options.inflate_threads = inflate_threads;
+      MdfReader reader(filename, options);
+      ASSERT_TRUE(reader.ReadEverythingButData());
+      DataGroupList dg_list;
+      reader.GetFile()->DataGroups(dg_list);
+      ASSERT_EQ(dg_list.size(), 1);
+      ChannelObserverList observer_list;
+      for (auto* group : dg_list[0]->ChannelGroups()) {
+        CreateChannelObserverForChannelGroup(*dg_list[0], *group, observer_list);
+      }
+      EXPECT_FALSE(reader.ReadData(*dg_list[0]));
+    }
+  }
+
+  MdfReader reader(filename);
+  ASSERT_TRUE(reader.ReadEverythingButData());
+  const auto* mdf4 = dynamic_cast<const Mdf4File*>(reader.GetFile());
+  ASSERT_TRUE(mdf4 != nullptr);
+  std::filebuf stream;
+  ASSERT_TRUE(stream.open(filename, std::ios_base::in | std::ios_base::binary) != nullptr);
+  DataListBuffer buffer(mdf4->Hd().Dg4()[0]->DataBlockList(), stream);
+  uint8_t dest[16] = {};
+  EXPECT_EQ(buffer.ReadAt(0, dest, 8), 8);
+  EXPECT_EQ(buffer.ReadAt(raw.size() - 8, dest, 16), 8); // Stops at the second block
+  EXPECT_EQ(buffer.ReadAt(raw.size(), dest, 8), 0);
+  stream.close();
+  remove(filename);
+}
+
+TEST_F(TestRead, LargeDtBlock) //NOLINT
+{
+  // The large DT block between two small DT blocks is larger than a read
+  // chunk. The positional backend reads it in chunks instead of in a batch.
+  const std::vector<size_t> size_list = {10, 300'000, 10};
+  const auto filename = (temp_directory_path() / "large_dt.mf4").string();
+  Mdf4Bytes file(0);
+  const auto hd = file.Block("##HD", {0, 0, 0, 0, 0, 0},
+                             Pack(uint64_t{0}, int16_t{0}, int16_t{0}, uint32_t{0},
+                                  0.0, 0.0));
+  const auto dg = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{0}));
+  size_t nof_samples = 0;
+  for (const auto size : size_list) {
+    nof_samples += size;
+  }
+  const auto cg = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                             Pack(uint64_t{0}, static_cast<uint64_t>(nof_samples),
+                                  uint32_t{0}, uint32_t{0}, uint32_t{8}, uint32_t{0}));
+  const auto time = file.Cn("Time", 2, 1, 4, 0, 64);
+  std::vector<int64_t> link_list = {0};
+  std::string dl_data = Pack(uint8_t{0}, uint8_t{0}, uint16_t{0},
+                             static_cast<uint32_t>(size_list.size()));
+  size_t sample = 0;
+  for (const auto size : size_list) {
+    dl_data += Pack(static_cast<uint64_t>(sample * 8));
+    std::string dt_data;
+    for (size_t index = 0; index < size; ++index, ++sample) {
+      dt_data += Pack(static_cast<double>(sample));
+    }
+    link_list.push_back(file.Block("##DT", {}, dt_data));
+  }
+  const auto dl = file.Block("##DL", link_list, dl_data);
+  file.Link(hd, 0, dg);
+  file.Link(dg, 1, cg);
+  file.Link(dg, 2, dl);
+  file.Link(cg, 1, time);
+  file.Save(filename);
+
+  for (const auto backend : {ReadBackend::FileStream, ReadBackend::MemoryMapped,
+                             ReadBackend::Positional}) {
+    MdfReaderOptions options;
+    options.backend = backend;
+    MdfReader reader(filename, options);
+    ASSERT_TRUE(reader.ReadEverythingButData());
+    DataGroupList dg_list;
+    reader.GetFile()->DataGroups(dg_list);
+    ASSERT_EQ(dg_list.size(), 1);
+    ChannelObserverList observer_list;
+    for (auto* group : dg_list[0]->ChannelGroups()) {
+      CreateChannelObserverForChannelGroup(*dg_list[0], *group, observer_list);
+    }
+    ASSERT_EQ(observer_list.size(), 1);
+    EXPECT_TRUE(reader.ReadData(*dg_list[0]));
+    ASSERT_EQ(observer_list[0]->NofSamples(), nof_samples);
+    for (sample = 0; sample < nof_samples; ++sample) {
+      double value = 0;
+      observer_list[0]->GetChannelValue(sample, value);
+      ASSERT_EQ(value, static_cast<double>(sample));
+    }
+  }
+  remove(filename);
+}
+
+TEST_F(TestRead, CorruptBlockLength) //NOLINT
+{
+  // A corrupt length or link count of the channel block shall fail the read
+  // without allocating the length.
+  const auto filename = (temp_directory_path() / "corrupt_length.mf4").string();
+  for (const bool link_count : {false, true}) {
+    Mdf4Bytes file(0);
+    const auto hd = file.Block("##HD", {0, 0, 0, 0, 0, 0},
+                               Pack(uint64_t{0}, int16_t{0}, int16_t{0}, uint32_t{0},
+                                    0.0, 0.0));
+    const auto dg = file.Block("##DG", {0, 0, 0, 0}, Pack(uint64_t{0}));
+    const auto cg = file.Block("##CG", {0, 0, 0, 0, 0, 0},
+                               Pack(uint64_t{0}, uint64_t{0}, uint32_t{0}, uint32_t{0},
+                                    uint32_t{8}, uint32_t{0}));
+    const auto time = file.Cn("Time", 2, 1, 4, 0, 64);
+    file.Link(hd, 0, dg);
+    file.Link(dg, 1, cg);
+    file.Link(cg, 1, time);
+    if (link_count) {
+      file.LinkCount(time, 1ULL << 61);
+    } else {
+      file.Length(time, 1ULL << 40);
+    }
+    file.Save(filename);
+
+    MdfReader reader(filename);
+    EXPECT_FALSE(reader.ReadEverythingButData()) << link_count;
+  }
+  remove(filename);
+}
+
+TEST_F(TestRead, RecordBuffer) //NOLINT
+{
+  // The 7 byte records don't align with the chunks, so some records
+  // straddle two chunks.
+  constexpr size_t kRecordSize = 7;
+  constexpr uint32_t kNofRecords = 1'000'000;
+  std::string data(kRecordSize * kNofRecords, '\0');
+  for (uint32_t record = 0; record < kNofRecords; ++record) {
+    std::memcpy(data.data() + record * kRecordSize, &record, sizeof(record));
+  }
+  std::stringbuf file(data);
+  RecordBuffer buffer(file, data.size());
+  uint32_t count = 0;
+  while (buffer.Fill(kRecordSize)) {
+    uint32_t value = 0;
+    std::memcpy(&value, buffer.Current(), sizeof(value));
+    ASSERT_EQ(value, count);
+    buffer.Skip(kRecordSize);
+    ++count;
+  }
+  EXPECT_EQ(count, kNofRecords);
+  EXPECT_EQ(buffer.Consumed(), data.size());
+}
+
+TEST_F(TestRead, LinkList) //NOLINT
+{
+  // The first links are stored in place, more links move to the heap
+  LinkList link_list;
+  for (int64_t link = 0; link < 100; ++link) {
+    link_list.emplace_back(link * 8);
+    ASSERT_EQ(link_list.size(), static_cast<size_t>(link + 1));
+    EXPECT_EQ(link_list[static_cast<size_t>(link)], link * 8);
+  }
+  const LinkList copy = link_list;
+  link_list.clear();
+  link_list.resize(4, 1);
+  EXPECT_EQ(link_list.size(), 4U);
+  EXPECT_EQ(link_list[3], 1);
+  EXPECT_EQ(copy.size(), 100U);
+  EXPECT_EQ(copy[99], 99 * 8);
+
+  BlockTypeId block_type;
+  EXPECT_TRUE(block_type.empty());
+  block_type = "##CN";
+  EXPECT_EQ(std::string(block_type), "##CN");
+  EXPECT_EQ(block_type.substr(2), "CN");
+}
+
+TEST_F(TestRead, RecordIdTable) //NOLINT
+{
+  int groups[4] = {};
+  RecordIdTable<int> table;
+  table.Add(1, &groups[0], 8);
+  EXPECT_EQ(table.Find(12345)->group, &groups[0]); // Only one group
+  table.Add(300, &groups[1], 16);
+  table.Add(70'000, &groups[2], 0);
+  table.Add(1ULL << 40, &groups[3], 4);
+  EXPECT_EQ(table.Find(1)->group, &groups[0]);
+  EXPECT_EQ(table.Find(300)->record_size, 16U);
+  EXPECT_EQ(table.Find(70'000)->group, &groups[2]);
+  EXPECT_EQ(table.Find(1ULL << 40)->group, &groups[3]);
+  EXPECT_EQ(table.Find(2), nullptr);
+  EXPECT_EQ(table.Find(70'001), nullptr);
+}
+
+TEST_F(TestRead, FindBlock) //NOLINT
+{
+  for (const auto &itr: mdf_list) {
+    MdfReader reader(itr.second);
+    EXPECT_TRUE(reader.ReadEverythingButData()) << itr.second;
+    const auto* mdf4 = dynamic_cast<const Mdf4File*>(reader.GetFile());
+    if (mdf4 == nullptr) {
+      continue;
+    }
+    for (const auto& dg4 : mdf4->Hd().Dg4()) {
+      EXPECT_EQ(mdf4->Find(dg4->FilePosition()), dg4.get()) << itr.second;
+      for (const auto& cg4 : dg4->Cg4()) {
+        EXPECT_EQ(mdf4->Hd().Find(cg4->FilePosition()), cg4.get()) << itr.second;
+        for (const auto& cn4 : cg4->Cn4()) {
+          EXPECT_EQ(mdf4->Find(cn4->FilePosition()), cn4.get()) << itr.second;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(TestRead, SharedBlocks) //NOLINT
+{
+  for (const auto &itr: mdf_list) {
+    MdfReader reader(itr.second);
+    EXPECT_TRUE(reader.ReadEverythingButData()) << itr.second;
+    const auto* mdf4 = dynamic_cast<const Mdf4File*>(reader.GetFile());
+    if (mdf4 == nullptr) {
+      continue;
+    }
+    // Channels that reference the same conversion shall share the block
+    std::map<std::pair<int64_t, ChannelDataType>, const Cc4Block*> cc_list;
+    for (const auto& dg4 : mdf4->Hd().Dg4()) {
+      for (const auto& cg4 : dg4->Cg4()) {
+        for (const auto& cn4 : cg4->Cn4()) {
+          const auto* cc4 = cn4->Cc();
+          if (cc4 == nullptr) {
+            continue;
+          }
+          const auto key = std::make_pair(cc4->FilePosition(), cn4->DataType());
+          const auto [find, inserted] = cc_list.emplace(key, cc4);
+          EXPECT_EQ(find->second, cc4) << itr.second;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(TestRead, SharedCommentCopyOnWrite) //NOLINT
+{
+  for (const auto &itr: mdf_list) {
+    MdfReader reader(itr.second);
+    EXPECT_TRUE(reader.ReadEverythingButData()) << itr.second;
+    const auto* mdf4 = dynamic_cast<const Mdf4File*>(reader.GetFile());
+    if (mdf4 == nullptr) {
+      continue;
+    }
+    // Editing a comment shall not change the comments of other blocks
+    std::vector<std::pair<Dg4Block*, std::string>> comment_list;
+    for (const auto& dg4 : mdf4->Hd().Dg4()) {
+      const auto* md4 = dg4->Md4();
+      if (md4 != nullptr) {
+        comment_list.emplace_back(dg4.get(), md4->XmlSnippet());
+      }
+    }
+    if (comment_list.empty()) {
+      continue;
+    }
+    auto* metadata = comment_list[0].first->MetaData();
+    ASSERT_TRUE(metadata != nullptr) << itr.second;
+    metadata->XmlSnippet("<DGcomment><TX>Edited</TX></DGcomment>");
+    EXPECT_EQ(comment_list[0].first->Md4()->XmlSnippet(), metadata->XmlSnippet()) << itr.second;
+    for (size_t index = 1; index < comment_list.size(); ++index) {
+      EXPECT_EQ(comment_list[index].first->Md4()->XmlSnippet(), comment_list[index].second) << itr.second;
+    }
+  }
+}
+
+TEST_F(TestRead, ConcurrentReadData) //NOLINT
+{
+  const auto filename = (temp_directory_path() / "concurrent_read.mf4").string();
+  CreateTestFile(filename);
+  MdfReader default_read(filename);
+  const auto expected = ReadValues(default_read);
+  ASSERT_FALSE(expected.empty());
+
+  MdfReader reader(filename, ReadBackend::Positional);
+  ASSERT_TRUE(reader.ReadEverythingButData());
+  ASSERT_TRUE(reader.Open());
+
+  DataGroupList dg_list;
+  reader.GetFile()->DataGroups(dg_list);
+  ASSERT_EQ(dg_list.size(), 2);
+  std::vector<ChannelObserverList> observer_list(dg_list.size());
+  std::vector<std::thread> thread_list;
+  for (size_t dg = 0; dg < dg_list.size(); ++dg) {
+    for (const auto* cg : dg_list[dg]->ChannelGroups()) {
+      CreateChannelObserverForChannelGroup(*dg_list[dg], *cg, observer_list[dg]);
+    }
+    thread_list.emplace_back([&reader, &dg_list, dg] {
+      EXPECT_TRUE(reader.ReadData(*dg_list[dg]));
+    });
+  }
+  for (auto& thread : thread_list) {
+    thread.join();
+  }
+  reader.Close();
+
+  ValueList value_list;
+  for (const auto& dg_observers : observer_list) {
+    for (auto& values : ObserverValues(dg_observers)) {
+      value_list.push_back(std::move(values));
+    }
+  }
+  EXPECT_EQ(value_list, expected);
+  remove(filename);
+}
+
 TEST_F(TestRead, DISABLED_Benchmark) {
   {
     MdfReader oRead("K:/test/mdf/net/testfiles/test.mf4");
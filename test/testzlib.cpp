@@ -2,7 +2,14 @@
  * Copyright 2021 Ingemar Hedvall
  * SPDX-License-Identifier: MIT
  */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
 #include "mdf/zlibutil.h"
 #include "testzlib.h"
 
@@ -184,5 +191,113 @@ TEST_F(TestZlib, Transpose)
 
 }
 
+TEST_F(TestZlib, InflateIntoBuffer)
+{
+  ByteArray buf_in(100'000, 0);
+  for (size_t ii = 0; ii < buf_in.size(); ++ii) {
+    buf_in[ii] = static_cast<uint8_t>(ii / 100);
+  }
+  ByteArray compressed(buf_in.size(), 0);
+  ASSERT_TRUE(Deflate(buf_in, compressed));
+
+  // Inflate into the middle of a larger buffer
+  ByteArray dest(buf_in.size() + 20, 0xFF);
+  size_t size = buf_in.size();
+  EXPECT_TRUE(Inflate(compressed.data(), compressed.size(), dest.data() + 10, size));
+  EXPECT_EQ(size, buf_in.size());
+  EXPECT_TRUE(std::equal(buf_in.begin(), buf_in.end(), dest.begin() + 10));
+  EXPECT_EQ(dest[9], 0xFF);
+  EXPECT_EQ(dest[buf_in.size() + 10], 0xFF);
+}
+
+TEST_F(TestZlib, TransposeRecordSizes)
+{
+  // Covers the SIMD tiles, the small record kernels and the untransposed tail
+  for (size_t record_size : {1, 2, 3, 4, 8, 12, 16, 17, 32, 33, 64}) {
+    for (size_t nof_records : {0, 1, 15, 16, 17, 33, 100}) {
+      ByteArray data(nof_records * record_size + record_size / 2, 0);
+      for (size_t index = 0; index < data.size(); ++index) {
+        data[index] = static_cast<uint8_t>(index * 7 + index / 256);
+      }
+      ByteArray transposed;
+      Transpose(data, transposed, record_size);
+      ASSERT_EQ(transposed.size(), data.size());
+      for (size_t record = 0; record < nof_records; ++record) {
+        for (size_t byte = 0; byte < record_size; ++byte) {
+          ASSERT_EQ(transposed[byte * nof_records + record], data[record * record_size + byte])
+            << record_size << "/" << nof_records;
+        }
+      }
+      for (size_t index = nof_records * record_size; index < data.size(); ++index) {
+        ASSERT_EQ(transposed[index], data[index]) << record_size << "/" << nof_records;
+      }
+      ByteArray orig;
+      InvTranspose(transposed, orig, record_size);
+      EXPECT_TRUE(orig == data) << record_size << "/" << nof_records;
+    }
+  }
+}
+
+TEST_F(TestZlib, DISABLED_Benchmark)
+{
+  // A DZ payload is normally a transposed 4 MB data block. The source MDF file
+  // is used as data block if it exists, otherwise sampled signals are generated.
+  constexpr size_t kBlockSize = 4'000'000;
+  constexpr size_t kRecordSize = 16;
+  constexpr size_t kLoops = 20;
+  ByteArray block;
+  if (!skip_test_) {
+    std::ifstream file(kTestFile, std::ios_base::in | std::ios_base::binary);
+    block.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    block.resize(std::min(block.size(), kBlockSize));
+  }
+  if (block.size() < kRecordSize) {
+    block.resize(kBlockSize, 0);
+    for (size_t record = 0; record < kBlockSize / kRecordSize; ++record) {
+      const double time = 0.01 * static_cast<double>(record);
+      const auto value = static_cast<float>(100.0 * std::sin(time));
+      const auto counter = static_cast<uint32_t>(record);
+      auto* dest = block.data() + record * kRecordSize;
+      memcpy(dest, &time, sizeof(time));
+      memcpy(dest + 8, &value, sizeof(value));
+      memcpy(dest + 12, &counter, sizeof(counter));
+    }
+  }
+  Transpose(block, kRecordSize);
+
+  ByteArray compressed(block.size(), 0);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t loop = 0; loop < kLoops; ++loop) {
+    compressed.resize(block.size());
+    ASSERT_TRUE(Deflate(block, compressed));
+  }
+  std::chrono::duration<double> deflate_time = std::chrono::steady_clock::now() - start;
+
+  ByteArray inflated(block.size(), 0);
+  start = std::chrono::steady_clock::now();
+  for (size_t loop = 0; loop < kLoops; ++loop) {
+    inflated.resize(block.size());
+    ASSERT_TRUE(Inflate(compressed, inflated));
+  }
+  std::chrono::duration<double> inflate_time = std::chrono::steady_clock::now() - start;
+  EXPECT_TRUE(inflated == block);
+
+  // The chunked stream path. libdeflate has no stream API, so that backend uses zlib here.
+  start = std::chrono::steady_clock::now();
+  for (size_t loop = 0; loop < kLoops; ++loop) {
+    std::stringbuf in(std::string(compressed.begin(), compressed.end()));
+    std::stringbuf out;
+    ASSERT_TRUE(Inflate(in, out, compressed.size()));
+  }
+  std::chrono::duration<double> stream_time = std::chrono::steady_clock::now() - start;
+
+  const auto mb = static_cast<double>(block.size() * kLoops) / 1'000'000.0;
+  std::cout << "Backend: " << DeflateBackend()
+            << ", Ratio: " << static_cast<double>(compressed.size()) / static_cast<double>(block.size()) << std::endl;
+  std::cout << "Deflate: " << mb / deflate_time.count() << " MB/s" << std::endl;
+  std::cout << "Inflate (single-shot): " << mb / inflate_time.count() << " MB/s" << std::endl;
+  std::cout << "Inflate (chunked stream): " << mb / stream_time.count() << " MB/s" << std::endl;
+}
+
 } // namespace util::test
 